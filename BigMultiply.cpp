@@ -0,0 +1,261 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+*/
+
+#include <cmath>
+#include <limits>
+#include "BigMultiply.h"
+
+/*
+    A coefficient of the convolution is at most length * 2^(2 * bits), the rounding
+    error grows like epsilon times that, so 2 * bits + log2(length) must stay
+    some 10 bits below the mantissa.
+*/
+int BigMultiply::BitsPerPoint(s64 length)
+{
+    int logLength = 0;
+    while ((((s64)1) << logLength) < length) logLength++;
+
+    int b = (std::numeric_limits<Data>::digits - 10 - logLength) / 2;
+    if (b > 24) b = 24;
+    if (b < 1) b = 1;
+    return b;
+}
+
+/*
+    The chunk size depends on the length and the length on the chunk size,
+    start with chunks of most bits and shrink until the length fits. With
+    half the transform holds two points, the convolution is twice its length.
+*/
+s64 BigMultiply::Plan(s64 bitsA, s64 bitsB, int most, bool half)
+{
+    int b = most;
+    s64 N = 0;
+
+    for (;;) {
+        s64 points = (bitsA + b - 1) / b + (bitsB + b - 1) / b - 1;
+        if (half) points = (points + 1) / 2;
+        N = pf.FastCalcFactors(points - 1, factors);
+        if (N <= 0) return -1;
+        int nb = BitsPerPoint(half ? 2 * N : N);
+        if (nb >= b) break;
+        b = nb;
+    }
+
+    bits = b;
+    if (N != length) {
+        pf.SetFactors(factors);
+        length = N;
+        real.resize(N);
+        imag.resize(N);
+        twiddleReal.clear();
+        twiddleImag.clear();
+    }
+    return N;
+}
+
+/*
+    Chunk i of a to even[i], or with odd chunk 2n to even[n] and 2n + 1 to odd[n].
+*/
+void BigMultiply::Split(const std::vector<uint>& a, Data* even, Data* odd)
+{
+    u64 acc = 0;
+    int accBits = 0;
+    std::size_t limb = 0;
+    u64 mask = (((u64)1) << bits) - 1;
+    s64 chunks = odd ? 2 * length : length;
+
+    for (s64 i = 0; i < chunks; i++) {
+        if (accBits < bits && limb < a.size()) {
+            acc |= ((u64)a[limb++]) << accBits;
+            accBits += 32;
+        }
+        Data chunk = (Data)(acc & mask);
+        if (!odd) even[i] = chunk;
+        else if (i & 1) odd[i >> 1] = chunk;
+        else even[i >> 1] = chunk;
+        acc >>= bits;
+        accBits = (accBits > bits) ? accBits - bits : 0;
+    }
+}
+
+/*
+    The coefficients are laid out as the chunks of Split.
+*/
+void BigMultiply::Carry(Data* even, Data* odd, s64 points, std::vector<uint>& result)
+{
+    u64 carry = 0;
+    u64 acc = 0;
+    int accBits = 0;
+    std::size_t limb = 0;
+    u64 mask = (((u64)1) << bits) - 1;
+
+    maxError = 0;
+    for (s64 i = 0; i < points; i++) {
+        Data c = !odd ? even[i] : (i & 1) ? odd[i >> 1] : even[i >> 1];
+        Data r = std::floor(c + (Data)0.5);
+        Data err = std::fabs(c - r);
+        if (err > maxError) maxError = err;
+        if (r < 0) r = 0;
+
+        carry += (u64)r;
+        acc |= (carry & mask) << accBits;
+        accBits += bits;
+        carry >>= bits;
+        while (accBits >= 32 && limb < result.size()) {
+            result[limb++] = (uint)acc;
+            acc >>= 32;
+            accBits -= 32;
+        }
+    }
+    while (limb < result.size()) {
+        acc |= (carry & 0xFFFFFFFF) << accBits;
+        carry >>= 32;
+        result[limb++] = (uint)acc;
+        acc >>= 32;
+    }
+}
+
+void BigMultiply::Schoolbook(const std::vector<uint>& a, const std::vector<uint>& b, std::vector<uint>& result)
+{
+    for (std::size_t i = 0; i < result.size(); i++) result[i] = 0;
+
+    for (std::size_t i = 0; i < a.size(); i++) {
+        u64 carry = 0;
+        for (std::size_t j = 0; j < b.size(); j++) {
+            u64 t = (u64)a[i] * b[j] + result[i + j] + carry;
+            result[i + j] = (uint)t;
+            carry = t >> 32;
+        }
+        result[i + b.size()] = (uint)carry;
+    }
+}
+
+/*
+    a goes in the real part and b in the imaginary part of one transform.
+    With X = A + iB and A, B spectra of real sequences
+        A[k] = (X[k] + conj(X[-k])) / 2,   B[k] = (X[k] - conj(X[-k])) / 2i
+    and the spectrum of the product is A[k] * B[k].
+*/
+s64 BigMultiply::Multiply(const std::vector<uint>& a, const std::vector<uint>& b, std::vector<uint>& result)
+{
+    result.resize(a.size() + b.size());
+
+    if (a.size() < SCHOOLBOOKLIMIT || b.size() < SCHOOLBOOKLIMIT) {
+        Schoolbook(a, b, result);
+        return result.size();
+    }
+
+    s64 bitsA = 32 * (s64)a.size();
+    s64 bitsB = 32 * (s64)b.size();
+    for (int most = 24; ; most = bits - 1)
+    {
+        if (Plan(bitsA, bitsB, most, false) < 0) return -1;
+        s64 points = (bitsA + bits - 1) / bits + (bitsB + bits - 1) / bits - 1;
+
+        Split(a, real.data(), 0);
+        Split(b, imag.data(), 0);
+
+        pf.forwardFFT(real.data(), imag.data());
+
+        for (s64 k = 0; k <= length / 2; k++) {
+            s64 j = (length - k) % length;
+            Data ar = (real[k] + real[j]) / 2;
+            Data ai = (imag[k] - imag[j]) / 2;
+            Data br = (imag[k] + imag[j]) / 2;
+            Data bi = (real[j] - real[k]) / 2;
+            Data pr = ar * br - ai * bi;
+            Data pi = ar * bi + ai * br;
+            real[k] = pr;
+            imag[k] = pi;
+            real[j] = pr;
+            imag[j] = -pi;
+        }
+
+        pf.ScaledInverseFFT(real.data(), imag.data());
+
+        Carry(real.data(), 0, points, result);
+        if (maxError <= MAXROUNDING) return result.size();
+        if (bits == 1) return -2;
+    }
+}
+
+/*
+    The even chunks e and the odd chunks o of a, M = length of each, are
+    z = e + io. The spectrum of the 2M chunks is, with W = e^(-2 pi i / 2M),
+        X[k] = E[k] + W^k O[k],   X[k + M] = E[k] - W^k O[k]
+    where E and O come out of Z as A and B in Multiply. The square of X is
+    the spectrum of a real sequence again, its even and odd parts have the
+    spectra
+        (X[k]^2 + X[k + M]^2) / 2 = E[k]^2 + W^2k O[k]^2
+        (X[k]^2 - X[k + M]^2) / 2W^k = 2 E[k] O[k]
+    which go back in the real and imaginary parts of the inverse transform.
+*/
+s64 BigMultiply::Square(const std::vector<uint>& a, std::vector<uint>& result)
+{
+    result.resize(2 * a.size());
+
+    if (a.size() < SCHOOLBOOKLIMIT) {
+        Schoolbook(a, a, result);
+        return result.size();
+    }
+
+    s64 bitsA = 32 * (s64)a.size();
+    for (int most = 24; ; most = bits - 1)
+    {
+        if (Plan(bitsA, bitsA, most, true) < 0) return -1;
+        s64 points = 2 * ((bitsA + bits - 1) / bits) - 1;
+
+        if ((s64)twiddleReal.size() != length) {
+            twiddleReal.resize(length);
+            twiddleImag.resize(length);
+            for (s64 k = 0; k < length; k++) {
+                long double w = 2.0L * 3.141592653589793238462643383279503L * k / length;
+                twiddleReal[k] = (Data)std::cos(w);
+                twiddleImag[k] = (Data)-std::sin(w);
+            }
+        }
+
+        Split(a, real.data(), imag.data());
+
+        pf.forwardFFT(real.data(), imag.data());
+
+        /* k and -k read each other, so both are done before they are stored */
+        for (s64 k = 0; k <= length / 2; k++) {
+            s64 j = (length - k) % length;
+            Data out[2][2];
+            for (int side = 0; side < 2; side++) {
+                s64 m = side ? j : k;
+                s64 n = side ? k : j;
+                Data er = (real[m] + real[n]) / 2;
+                Data ei = (imag[m] - imag[n]) / 2;
+                Data odr = (imag[m] + imag[n]) / 2;
+                Data odi = (real[n] - real[m]) / 2;
+                Data o2r = odr * odr - odi * odi;
+                Data o2i = 2 * odr * odi;
+                Data evenR = er * er - ei * ei + twiddleReal[m] * o2r - twiddleImag[m] * o2i;
+                Data evenI = 2 * er * ei + twiddleReal[m] * o2i + twiddleImag[m] * o2r;
+                Data oddR = 2 * (er * odr - ei * odi);
+                Data oddI = 2 * (er * odi + ei * odr);
+                out[side][0] = evenR - oddI;
+                out[side][1] = evenI + oddR;
+            }
+            real[k] = out[0][0];
+            imag[k] = out[0][1];
+            real[j] = out[1][0];
+            imag[j] = out[1][1];
+        }
+
+        pf.ScaledInverseFFT(real.data(), imag.data());
+
+        Carry(real.data(), imag.data(), points, result);
+        if (maxError <= MAXROUNDING) return result.size();
+        if (bits == 1) return -2;
+    }
+}
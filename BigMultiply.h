@@ -0,0 +1,83 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+	Multiplication of non negative big integers with the prime factor FFT.
+
+	The operands are split in chunks of b bits, one chunk per point, the
+	product is the cyclic convolution of the chunks, which is exact as long as
+	the rounding error stays below 1/2. b is chosen from the length and the
+	precision of Data, so a PFA_LONG_DOUBLE build packs more bits per point.
+	A product whose rounding error is over MAXROUNDING is done again with
+	smaller chunks.
+*/
+#include "PrimeFactorDFT.h"
+
+/*
+*  Below this many limbs in the shorter operand the schoolbook product is used.
+*/
+#define SCHOOLBOOKLIMIT 40
+
+/*
+*  The largest rounding error a transform based product is trusted with.
+*/
+#define MAXROUNDING ((Data)0.25)
+
+class BigMultiply
+{
+public:
+
+	BigMultiply() { length = 0; bits = 0; maxError = 0; };
+	~BigMultiply() {};
+
+	/*
+	*  Numbers are vectors of 32 bit limbs, least significant first.
+	*  result gets a.size() + b.size() limbs.
+	*  Returns the number of limbs in result,
+	*  or -1 if the operands are too long for the supported FFT lengths,
+	*  or -2 if the rounding error stays over MAXROUNDING down to 1 bit per point.
+	*/
+	s64 Multiply(const std::vector<uint>& a, const std::vector<uint>& b, std::vector<uint>& result);
+
+	/*
+	*  As Multiply(a, a, result). The chunks are real, so even and odd chunks
+	*  go in the real and imaginary parts of one transform of half the length,
+	*  a forward and an inverse transform of half the length of Multiply's.
+	*/
+	s64 Square(const std::vector<uint>& a, std::vector<uint>& result);
+
+	/*
+	*  Largest distance from a convolution coefficient to the nearest integer
+	*  in the last transform based product, at most MAXROUNDING when it
+	*  succeeded.
+	*/
+	Data MaxError() { return maxError; };
+
+	/*
+	*  The chunk size in bits used with a transform of the given length.
+	*/
+	static int BitsPerPoint(s64 length);
+
+private:
+	s64 Plan(s64 bitsA, s64 bitsB, int most, bool half);
+	void Split(const std::vector<uint>& a, Data* even, Data* odd);
+	void Carry(Data* even, Data* odd, s64 points, std::vector<uint>& result);
+	void Schoolbook(const std::vector<uint>& a, const std::vector<uint>& b, std::vector<uint>& result);
+
+	PrimeFactorDFT pf;
+	factorSeq factors;
+	s64 length;
+	int bits;
+	Data maxError;
+	std::vector<Data> real;
+	std::vector<Data> imag;
+	/* e^(-2 pi i k / length) for Square */
+	std::vector<Data> twiddleReal;
+	std::vector<Data> twiddleImag;
+};
@@ -0,0 +1,122 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+*/
+
+#include "MultiDimDFT.h"
+
+/* below this many points an axis is done by the calling thread */
+#define THREADLIMIT  (1 << 16)
+
+void MultiDimDFT::CleanUp()
+{
+    while (axes.size()) {
+        delete axes.back();
+        axes.pop_back();
+    }
+    size = 0;
+}
+
+/*
+    The stride of an axis is the product of the lengths of the faster axes.
+*/
+s64 MultiDimDFT::SetAxes(std::vector<factorSeq>& axisFactors)
+{
+    CleanUp();
+
+    std::vector<s64> lengths(axisFactors.size());
+    for (std::size_t a = 0; a < axisFactors.size(); a++) {
+        PrimeFactorDFT plan;
+        plan.SetFactors(axisFactors[a]);
+        if (plan.Status() <= 0) {
+            size = plan.Status();
+            return size;
+        }
+        lengths[a] = plan.Status();
+    }
+
+    s64 stride = 1;
+    axes.resize(axisFactors.size());
+    for (std::size_t a = axisFactors.size(); a-- > 0; ) {
+        axes[a] = new PrimeFactorDFT();
+        axes[a]->SetLayout(stride);
+        axes[a]->SetFactors(axisFactors[a]);
+        stride *= lengths[a];
+    }
+    size = stride;
+    return size;
+}
+
+/*
+    Line l of an axis with length n and stride s starts at
+        (l / s) * s * n + l % s
+*/
+void MultiDimDFT::Lines(PrimeFactorDFT* plan, Data* real, Data *imag, s64 first, s64 last, s64 length, int direction)
+{
+    s64 stride = plan->Stride();
+    for (s64 l = first; l < last; l++) {
+        s64 offset = (l / stride) * stride * length + l % stride;
+        if (direction == FORWARD)
+            plan->forwardFFT(real + offset, imag + offset);
+        else
+            plan->InverseFFT(real + offset, imag + offset);
+    }
+}
+
+void MultiDimDFT::Axis(std::size_t axis, Data* real, Data *imag, int direction)
+{
+    PrimeFactorDFT* plan = axes[axis];
+    s64 length = plan->Status();
+    s64 lines = size / length;
+
+    s64 t = (threads > 0) ? threads : (s64)pool->Workers() + 1;
+    if (size < THREADLIMIT) t = 1;
+
+    pool->ParallelFor(0, lines, t, [plan, real, imag, length, direction](s64 first, s64 last) {
+        Lines(plan, real, imag, first, last, length, direction);
+    });
+}
+
+void MultiDimDFT::forwardFFT(Data* real, Data *imag)
+{
+    for (std::size_t a = 0; a < axes.size(); a++)
+        Axis(a, real, imag, FORWARD);
+}
+
+void MultiDimDFT::InverseFFT(Data* real, Data *imag)
+{
+    for (std::size_t a = 0; a < axes.size(); a++)
+        Axis(a, real, imag, INVERSE);
+}
+
+void MultiDimDFT::ScaledInverseFFT(Data* real, Data *imag)
+{
+    InverseFFT(real, imag);
+    for (s64 i = 0; i < size; i++)
+    {
+        real[i] /= size;
+        imag[i] /= size;
+    }
+}
+
+s64 PrimeFactorDFT2D::SetFactors(factorSeq& rowFactors, factorSeq& columnFactors)
+{
+    std::vector<factorSeq> axisFactors;
+    axisFactors.push_back(rowFactors);
+    axisFactors.push_back(columnFactors);
+    return SetAxes(axisFactors);
+}
+
+s64 PrimeFactorDFT3D::SetFactors(factorSeq& planeFactors, factorSeq& rowFactors, factorSeq& columnFactors)
+{
+    std::vector<factorSeq> axisFactors;
+    axisFactors.push_back(planeFactors);
+    axisFactors.push_back(rowFactors);
+    axisFactors.push_back(columnFactors);
+    return SetAxes(axisFactors);
+}
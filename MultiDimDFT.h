@@ -0,0 +1,83 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+	Two and three dimensional transforms of row major arrays, the last index
+	running fastest.
+
+	Every axis has its own PrimeFactorDFT with the stride of that axis, so
+	the lines along an axis are transformed where they lie and no transpose
+	is needed. The lines of an axis are split in chunks that run on a
+	ThreadPool, they share the plan of the axis. The length of every axis must be a supported
+	transform length, e.g. 1155 x 1309 = (3 5 7 11) x (7 11 17).
+*/
+#include "PrimeFactorDFT.h"
+#include "ThreadPool.h"
+
+class MultiDimDFT
+{
+public:
+
+	MultiDimDFT() { size = 0; threads = 0; pool = ThreadPool::Default(); };
+	virtual ~MultiDimDFT() { CleanUp(); };
+
+	/*
+	*  Number of chunks the lines of an axis are split in, 0 is one per
+	*  worker of the pool and one for the calling thread.
+	*/
+	void SetThreads(int _threads) { threads = _threads; };
+
+	/* default ThreadPool::Default() */
+	void SetPool(ThreadPool* _pool) { pool = _pool; };
+
+	/*
+	*  if > 0 the number of points.
+	*  otherwise the Status() of the first axis without a valid length.
+	*/
+	s64 Status() { return size; };
+
+	void forwardFFT(Data* real, Data *imag);
+	void InverseFFT(Data* real, Data *imag);
+	void ScaledInverseFFT(Data* real, Data *imag);
+
+protected:
+	/* the slowest axis first */
+	s64 SetAxes(std::vector<factorSeq>& axisFactors);
+
+private:
+	enum { FORWARD, INVERSE };
+
+	void CleanUp();
+	void Axis(std::size_t axis, Data* real, Data *imag, int direction);
+	static void Lines(PrimeFactorDFT* plan, Data* real, Data *imag, s64 first, s64 last, s64 length, int direction);
+
+	std::vector<PrimeFactorDFT*> axes;
+	s64 size;
+	int threads;
+	ThreadPool* pool;
+};
+
+class PrimeFactorDFT2D : public MultiDimDFT
+{
+public:
+	/*
+	*  rows x columns points, point (r, c) at r * columns + c.
+	*/
+	s64 SetFactors(factorSeq& rowFactors, factorSeq& columnFactors);
+};
+
+class PrimeFactorDFT3D : public MultiDimDFT
+{
+public:
+	/*
+	*  planes x rows x columns points, point (p, r, c) at (p * rows + r) * columns + c.
+	*/
+	s64 SetFactors(factorSeq& planeFactors, factorSeq& rowFactors, factorSeq& columnFactors);
+};
@@ -0,0 +1,154 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+*/
+
+#include "OutOfCoreDFT.h"
+
+#ifdef NOTWIN
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+s64 OutOfCoreDFT::Open(const char* path, factorSeq& factors, bool create)
+{
+    Close();
+
+    pf.SetFactors(factors);
+    if (pf.Status() <= 0) return pf.Status();
+
+#ifdef NOTWIN
+    s64 N = pf.Status();
+    s64 bytes = 2 * N * (s64)sizeof(Data);
+
+    fd = open(path, create ? (O_RDWR | O_CREAT | O_TRUNC) : O_RDWR, 0644);
+    if (fd < 0) return -1;
+
+    if (create) {
+        if (ftruncate(fd, bytes) != 0) { Close(); return -1; }
+    }
+    else if (lseek(fd, 0, SEEK_END) < bytes) { Close(); return -1; }
+
+    void* m = mmap(0, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) { Close(); return -1; }
+
+    map = (Data*)m;
+    mapBytes = bytes;
+    length = N;
+    madvise(map, mapBytes, MADV_SEQUENTIAL);
+    return length;
+#else
+    (void)path;
+    (void)create;
+    return -1;
+#endif
+}
+
+void OutOfCoreDFT::Close()
+{
+#ifdef NOTWIN
+    if (map) {
+        msync(map, mapBytes, MS_SYNC);
+        munmap(map, mapBytes);
+    }
+    if (fd >= 0) close(fd);
+#endif
+    map = 0;
+    mapBytes = 0;
+    fd = -1;
+    length = 0;
+}
+
+/*
+    The pages of the points j + m * count, begin <= j < end, in both halves.
+    Pages to read are rounded outwards, pages to drop inwards, so the ends
+    shared with the neighbour chunks stay.
+*/
+void OutOfCoreDFT::Advise(s64 count, uint factor, s64 begin, s64 end, int advice)
+{
+#ifdef NOTWIN
+    static const s64 page = sysconf(_SC_PAGESIZE);
+    char* base = (char*)map;
+
+    for (int half = 0; half < 2; half++)
+    for (uint m = 0; m < factor; m++)
+    {
+        s64 first = ((half ? length : 0) + m * count + begin) * (s64)sizeof(Data);
+        s64 last = ((half ? length : 0) + m * count + end) * (s64)sizeof(Data);
+        if (advice == MADV_WILLNEED) {
+            first = first / page * page;
+            last = (last + page - 1) / page * page;
+            if (last > mapBytes) last = mapBytes;
+        }
+        else {
+            first = (first + page - 1) / page * page;
+            last = last / page * page;
+            if (last > first) msync(base + first, last - first, MS_ASYNC);
+        }
+        if (last > first) madvise(base + first, last - first, advice);
+    }
+#else
+    (void)count; (void)factor; (void)begin; (void)end; (void)advice;
+#endif
+}
+
+void OutOfCoreDFT::Run(bool inverse)
+{
+#ifdef NOTWIN
+    if (!map) return;
+
+    factorSeq factors;
+    pf.GetFactors(factors);
+
+    for (std::size_t s = 0; s < pf.Stages(); s++)
+    {
+        s64 count = pf.Butterflies(s);
+        s64 chunk = memory / (2 * (s64)factors[s] * (s64)sizeof(Data));
+        if (chunk < 1) chunk = 1;
+
+        Advise(count, factors[s], 0, (chunk < count) ? chunk : count, MADV_WILLNEED);
+        for (s64 begin = 0; begin < count; begin += chunk)
+        {
+            s64 end = (begin + chunk < count) ? begin + chunk : count;
+            if (end < count)
+                Advise(count, factors[s], end, (end + chunk < count) ? end + chunk : count, MADV_WILLNEED);
+
+            if (inverse)
+                pf.InverseStage(s, Real(), Imag(), begin, end);
+            else
+                pf.forwardStage(s, Real(), Imag(), begin, end);
+
+            Advise(count, factors[s], begin, end, MADV_DONTNEED);
+        }
+    }
+#else
+    (void)inverse;
+#endif
+}
+
+void OutOfCoreDFT::ScaledInverseFFT()
+{
+    if (!map) return;
+    InverseFFT();
+
+    Data* real = Real();
+    Data* imag = Imag();
+    s64 chunk = memory / (2 * (s64)sizeof(Data));
+    if (chunk < 1) chunk = 1;
+    for (s64 begin = 0; begin < length; begin += chunk)
+    {
+        s64 end = (begin + chunk < length) ? begin + chunk : length;
+        for (s64 i = begin; i < end; i++) {
+            real[i] /= length;
+            imag[i] /= length;
+        }
+        Advise(length, 1, begin, end, MADV_DONTNEED);
+    }
+}
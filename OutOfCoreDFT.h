@@ -0,0 +1,68 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+	Transforms of data in a memory mapped file, for lengths whose data does
+	not fit in memory. The file holds the N real values followed by the N
+	imaginary values.
+
+	The transform runs stage by stage. Butterfly j of a stage with count
+	butterflies reads the points j + m * count, m < factor, so taking the
+	butterflies in order reads factor sequential streams from each half of
+	the file. The butterflies go in chunks sized by the memory budget: the
+	pages of the next chunk are asked for (MADV_WILLNEED) while the current
+	chunk is computed, and the pages of a finished chunk are handed back.
+
+	The supported factors each appear once, so the longest transform is
+	still 2*3*5*7*11*13*17*19*31 = 300690390 points, 4.8 GB of doubles, but
+	it no longer needs that much memory. Not available on Windows.
+*/
+#include "PrimeFactorDFT.h"
+
+class OutOfCoreDFT
+{
+public:
+
+	OutOfCoreDFT() { fd = -1; map = 0; mapBytes = 0; length = 0; memory = (s64)256 << 20; };
+	~OutOfCoreDFT() { Close(); };
+
+	/*
+	*  Maps the file for a transform with these factors. With create the file
+	*  is made, or cut, to the size and holds 0.
+	*  Returns the length, -1 if the file can not be mapped, or the Status()
+	*  of invalid factors.
+	*/
+	s64 Open(const char* path, factorSeq& factors, bool create = false);
+
+	/* writes the data back to the file and unmaps it */
+	void Close();
+
+	/* bytes of the file in memory per chunk of butterflies, default 256 MB */
+	void SetMemory(s64 bytes) { memory = bytes; };
+
+	/* the mapped data */
+	Data* Real() { return map; };
+	Data* Imag() { return map ? map + length : 0; };
+
+	void forwardFFT() { Run(false); };
+	void InverseFFT() { Run(true); };
+	void ScaledInverseFFT();
+
+private:
+	void Run(bool inverse);
+	void Advise(s64 count, uint factor, s64 begin, s64 end, int advice);
+
+	PrimeFactorDFT pf;
+	int fd;
+	Data* map;
+	s64 mapBytes;
+	s64 length;
+	s64 memory;
+};
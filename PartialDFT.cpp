@@ -0,0 +1,133 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+*/
+
+#include <cmath>
+#include "PartialDFT.h"
+
+/* bins evaluated side by side */
+#define BLOCK 8
+
+s64 PartialDFT::SetBins(factorSeq& factors, const std::vector<s64>& _bins)
+{
+    pf.SetFactors(factors);
+    length = pf.Status();
+    if (length <= 0) return length;
+
+    bins.resize(_bins.size());
+    cosine.resize(_bins.size());
+    sine.resize(_bins.size());
+    for (std::size_t b = 0; b < _bins.size(); b++) {
+        bins[b] = ((_bins[b] % length) + length) % length;
+        long double w = 2.0L * 3.141592653589793238462643383279503L * bins[b] / length;
+        cosine[b] = (Data)std::cos(w);
+        sine[b] = (Data)-std::sin(w);
+    }
+
+    /*
+        A recurrence step is a complex multiply and add, 8 operations, on whole
+        blocks of bins. The steps of a block stay in registers and vectorize, they
+        run at some four times the rate of the modules, which load and store
+        every point.
+    */
+    s64 transform = pf.Operations();
+    s64 blocks = ((s64)bins.size() + BLOCK - 1) / BLOCK;
+    s64 recurrence = 2 * length * BLOCK * blocks;
+
+    full = recurrence > transform;
+    if (full) {
+        real.resize(length);
+        imag.resize(length);
+    }
+    else {
+        real.clear();
+        imag.clear();
+    }
+    return length;
+}
+
+/*
+    Horner's rule for X = sum x[n] z^n with z = e^(-iw),
+        y = y * z + x[n],  n = N - 1, ..., 0
+    The second order Goertzel recurrence saves half the multiplies, but its
+    error grows like N^2 for bins near 0 and N / 2, here it grows like N.
+*/
+void PartialDFT::Recurrence(const Data* _real, const Data* _imag, Data* binReal, Data* binImag)
+{
+    s64 count = (s64)bins.size();
+
+    for (s64 first = 0; first < count; first += BLOCK)
+    {
+        int n = (int)((count - first < BLOCK) ? count - first : BLOCK);
+        Data c[BLOCK] = { 0 };
+        Data s[BLOCK] = { 0 };
+        Data yr[BLOCK] = { 0 };
+        Data yi[BLOCK] = { 0 };
+        for (int b = 0; b < n; b++) {
+            c[b] = cosine[first + b];
+            s[b] = sine[first + b];
+        }
+
+        if (_imag) {
+            for (s64 i = length - 1; i >= 0; i--) {
+                Data xr = _real[i];
+                Data xi = _imag[i];
+                for (int b = 0; b < BLOCK; b++) {
+                    Data t = yr[b] * c[b] - yi[b] * s[b] + xr;
+                    yi[b] = yr[b] * s[b] + yi[b] * c[b] + xi;
+                    yr[b] = t;
+                }
+            }
+        }
+        else {
+            for (s64 i = length - 1; i >= 0; i--) {
+                Data xr = _real[i];
+                for (int b = 0; b < BLOCK; b++) {
+                    Data t = yr[b] * c[b] - yi[b] * s[b] + xr;
+                    yi[b] = yr[b] * s[b] + yi[b] * c[b];
+                    yr[b] = t;
+                }
+            }
+        }
+
+        for (int b = 0; b < n; b++) {
+            binReal[first + b] = yr[b];
+            binImag[first + b] = yi[b];
+        }
+    }
+}
+
+void PartialDFT::Transform(const Data* _real, const Data* _imag, Data* binReal, Data* binImag)
+{
+    for (s64 i = 0; i < length; i++) {
+        real[i] = _real[i];
+        imag[i] = _imag ? _imag[i] : 0;
+    }
+    pf.forwardFFT(real.data(), imag.data());
+    for (std::size_t b = 0; b < bins.size(); b++) {
+        binReal[b] = real[bins[b]];
+        binImag[b] = imag[bins[b]];
+    }
+}
+
+void PartialDFT::Evaluate(const Data* _real, Data* binReal, Data* binImag)
+{
+    Evaluate(_real, 0, binReal, binImag);
+}
+
+void PartialDFT::Evaluate(const Data* _real, const Data* _imag, Data* binReal, Data* binImag)
+{
+    if (length <= 0) return;
+
+    if (full)
+        Transform(_real, _imag, binReal, binImag);
+    else
+        Recurrence(_real, _imag, binReal, binImag);
+}
@@ -0,0 +1,63 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+	A few bins of a transform, X[k] = sum x[n] e^(-2 pi i n k / N) for the
+	selected k only.
+
+	Every bin is a Goertzel style recurrence over the input, a few operations
+	per point and bin, against the cost of the whole transform. SetBins makes
+	one choice for all the bins: the recurrences of a block of 8 bins run
+	side by side, so they vectorize across the bins, and cost 2 * N * 8
+	operations per block, started blocks counted whole. If that is more than
+	Operations() of the plan all bins come from a full transform. With
+	N = 1155 = 3 * 5 * 7 * 11 the transform is 53339 operations, so up to 16
+	bins use the recurrences, from 17 on the transform. A real input needs no
+	imaginary buffer unless the full transform is used.
+*/
+#include "PrimeFactorDFT.h"
+
+class PartialDFT
+{
+public:
+
+	PartialDFT() { length = 0; full = false; };
+	~PartialDFT() {};
+
+	/*
+	*  The bins to evaluate for transforms with these factors, taken modulo
+	*  the length. Returns the length, or the Status() of invalid factors.
+	*/
+	s64 SetBins(factorSeq& factors, const std::vector<s64>& _bins);
+
+	/*
+	*  binReal[b], binImag[b] is bin _bins[b] of the transform of the input.
+	*/
+	void Evaluate(const Data* real, Data* binReal, Data* binImag);
+	void Evaluate(const Data* real, const Data* imag, Data* binReal, Data* binImag);
+
+	/* true if the bins are taken from a full transform */
+	bool FullTransform() { return full; };
+
+private:
+	void Recurrence(const Data* real, const Data* imag, Data* binReal, Data* binImag);
+	void Transform(const Data* real, const Data* imag, Data* binReal, Data* binImag);
+
+	PrimeFactorDFT pf;
+	s64 length;
+	bool full;
+	std::vector<s64> bins;
+	/* e^(-iw) per bin, w = 2 pi k / N */
+	std::vector<Data> cosine;
+	std::vector<Data> sine;
+	/* only for the full transform */
+	std::vector<Data> real;
+	std::vector<Data> imag;
+};
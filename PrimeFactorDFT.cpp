@@ -21,11 +21,22 @@ Inspiration originally from
 */
 
 
+#include <algorithm>
 #include <iostream>
 #include <list>
+#include <memory>
+#include <thread>
 #include "PrimeFactorDFT.h"
-
-s64 PrimeFactorDFT::ValidateFactors(factorSeq& _factors)
+#include "ThreadPool.h"
+#ifdef NOTWIN
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+#ifdef WIN
+#include <malloc.h>
+#endif
+
+s64 PrimeFactorPlan::ValidateFactors(factorSeq& _factors)
 {
     int f2 = 0;
     int f3 = 0;
@@ -81,19 +92,19 @@ void PrimeFactorDFT::InitDFT(factorSeq& _factors, std::vector<BasicDFT*> &_DFTs)
 	for (std::size_t i = 0;i < _factors.size();i++)
 	{
 		std::vector<s64>  indices;
-		InitIndices(indices, _factors[i], (int) state);
+		InitIndices(indices, _factors[i], state, stride);
 		BasicDFT* t;
 		switch (_factors[i])
 		{
-        case 2:  t = (BasicDFT*) new   DFT2(Rotations[i], state / 2, indices); 	_DFTs.push_back(t); break;
-        case 3:  t = (BasicDFT*) new   DFT3(Rotations[i], state / 3, indices); 	_DFTs.push_back(t); break;
-		case 5:  t = (BasicDFT*) new   DFT5(Rotations[i], state / 5, indices); 	_DFTs.push_back(t); break;
-		case 7:  t = (BasicDFT*) new   DFT7(Rotations[i], state / 7, indices); 	_DFTs.push_back(t); break;
-		case 11: t = (BasicDFT*) new  DFT11(Rotations[i], state / 11, indices); 	_DFTs.push_back(t); break;
-		case 13: t = (BasicDFT*) new  DFT13(Rotations[i], state / 13, indices); 	_DFTs.push_back(t); break;
-		case 17: t = (BasicDFT*) new  DFT17(Rotations[i], state / 17, indices); 	_DFTs.push_back(t); break;
-		case 19: t = (BasicDFT*) new  DFT19(Rotations[i], state / 19, indices); 	_DFTs.push_back(t); break;
-		case 31: t = (BasicDFT*) new  DFT31(Rotations[i], state / 31, indices); 	_DFTs.push_back(t); break;
+        case 2:  t = (BasicDFT*) new   DFT2(Rotations[i], state / 2, indices, stride); 	_DFTs.push_back(t); break;
+        case 3:  t = (BasicDFT*) new   DFT3(Rotations[i], state / 3, indices, stride); 	_DFTs.push_back(t); break;
+		case 5:  t = (BasicDFT*) new   DFT5(Rotations[i], state / 5, indices, stride); 	_DFTs.push_back(t); break;
+		case 7:  t = (BasicDFT*) new   DFT7(Rotations[i], state / 7, indices, stride); 	_DFTs.push_back(t); break;
+		case 11: t = (BasicDFT*) new  DFT11(Rotations[i], state / 11, indices, stride); 	_DFTs.push_back(t); break;
+		case 13: t = (BasicDFT*) new  DFT13(Rotations[i], state / 13, indices, stride); 	_DFTs.push_back(t); break;
+		case 17: t = (BasicDFT*) new  DFT17(Rotations[i], state / 17, indices, stride); 	_DFTs.push_back(t); break;
+		case 19: t = (BasicDFT*) new  DFT19(Rotations[i], state / 19, indices, stride); 	_DFTs.push_back(t); break;
+		case 31: t = (BasicDFT*) new  DFT31(Rotations[i], state / 31, indices, stride); 	_DFTs.push_back(t); break;
 		default: std::cout << "PFADFT::PFADT something is wrong here, Factorlist[" << i << "]= " << state << std::endl;
 		}
 	}
@@ -109,35 +120,395 @@ void PrimeFactorDFT::CleanUpDFT( std::vector<BasicDFT*> &_DFTs)
     //(void)_DTFs;
 }
 
-void PrimeFactorDFT::forwardFFT(Data* real, Data *imag)
+void PrimeFactorDFT::SetLayout(s64 _stride, s64 _batchCount, s64 _batchDistance)
 {
-	for (std::vector<BasicDFT*>::const_iterator it = DFTs.begin();it != DFTs.end();it++)
-	{
-		(*it)->Evaluate(real, imag);
+	s64 oldStride = stride;
+	stride = (_stride > 0) ? _stride : 1;
+	batchCount = (_batchCount > 0) ? _batchCount : 1;
+	batchDistance = _batchDistance;
+
+	/* the module index tables hold the stride */
+	if (stride != oldStride && state > 0) {
+		CleanUpDFT(DFTs);
+		InitDFT(factors, DFTs);
 	}
-};
-void PrimeFactorDFT::InverseFFT(Data* real, Data *imag)
+}
+
+/* points per chunk of a stage on the pool */
+#define POOLCHUNK  (1 << 13)
+
+void PrimeFactorDFT::Stage(std::size_t stage, Data* real, Data *imag, s64 begin, s64 end, const StageOutput* output)
 {
-	for (std::vector<BasicDFT*>::const_iterator it = DFTs.begin();it != DFTs.end();it++)
+	BasicDFT* dft = DFTs[stage];
+	s64 chunks = (end - begin) * factors[stage] / POOLCHUNK;
+	if (pool == 0 || state < POOLLIMIT || chunks < 2) {
+		if (output) dft->Evaluate(real, imag, begin, end, output);
+		else dft->Evaluate(real, imag, begin, end);
+		return;
+	}
+
+	s64 most = 4 * ((s64)pool->Workers() + 1);
+	if (chunks > most) chunks = most;
+	if (!output) {
+		pool->ParallelFor(begin, end, chunks, [dft, real, imag](s64 first, s64 last) {
+			dft->Evaluate(real, imag, first, last);
+		});
+		return;
+	}
+
+	/* chunk c goes to a sink of its own, joined in chunk order */
+	std::vector<StageOutput> outputs(chunks, *output);
+	for (s64 c = 0; c < chunks; c++)
+		if ((outputs[c].sink = output->sink->Fork()) == 0) {
+			while (c-- > 0) delete outputs[c].sink;
+			dft->Evaluate(real, imag, begin, end, output);
+			return;
+		}
+
+	StageOutput* parts = outputs.data();
+	pool->ParallelFor(0, chunks, chunks, [dft, real, imag, begin, end, chunks, parts](s64 first, s64 last) {
+		for (s64 c = first; c < last; c++)
+			dft->Evaluate(real, imag, begin + c * (end - begin) / chunks, begin + (c + 1) * (end - begin) / chunks, &parts[c]);
+	});
+	for (s64 c = 0; c < chunks; c++) {
+		output->sink->Join(outputs[c].sink);
+		delete outputs[c].sink;
+	}
+}
+
+/*
+    With sink the last stage passes its outputs to sink, on the pool only if
+    the sink can Fork. The sink goes along with the call, so transforms
+    without one may run on the same plan at the same time.
+*/
+void PrimeFactorDFT::Run(Data* real, Data *imag, bool inverse, StageSink* sink, bool store)
+{
+	StageOutput output = { sink, store, 0 };
+	for (s64 b = 0; b < batchCount; b++, real += batchDistance, imag += batchDistance)
+	for (std::size_t s = 0; s < DFTs.size(); s++)
 	{
-		(*it)->Evaluate(imag, real);
+		output.batch = b;
+		const StageOutput* last = (sink && s + 1 == DFTs.size()) ? &output : 0;
+		if (inverse) Stage(s, imag, real, 0, DFTs[s]->Butterflies(), last);
+		else Stage(s, real, imag, 0, DFTs[s]->Butterflies(), last);
 	}
+}
 
+void PrimeFactorDFT::forwardFFT(Data* real, Data *imag)
+{
+	Run(real, imag, false);
+};
+void PrimeFactorDFT::InverseFFT(Data* real, Data *imag)
+{
+	Run(real, imag, true);
 };
+std::future<void> PrimeFactorDFT::Async(Data* real, Data *imag, bool inverse, std::function<void()> done)
+{
+	std::shared_ptr< std::promise<void> > finished(new std::promise<void>());
+	std::future<void> result = finished->get_future();
+
+	ThreadPool* runner = pool ? pool : ThreadPool::Default();
+	runner->Submit([this, real, imag, inverse, done, finished] {
+		Run(real, imag, inverse);
+		if (done) done();
+		finished->set_value();
+	});
+	return result;
+}
+
+std::future<void> PrimeFactorDFT::forwardFFTAsync(Data* real, Data *imag, std::function<void()> done)
+{
+	return Async(real, imag, false, done);
+}
+
+std::future<void> PrimeFactorDFT::InverseFFTAsync(Data* real, Data *imag, std::function<void()> done)
+{
+	return Async(real, imag, true, done);
+}
+
 void PrimeFactorDFT::ScaledInverseFFT(Data* real, Data *imag)
 {
-	for (std::vector<BasicDFT*>::const_iterator it = DFTs.begin();it != DFTs.end();it++)
-	{
-		(*it)->Evaluate(imag, real);
-	}
-	for (uint i = 0; i < state; i++)
+	InverseFFT(real, imag);
+	if (state <= 0) return;
+	for (s64 b = 0; b < batchCount; b++, real += batchDistance, imag += batchDistance)
+	for (s64 i = 0; i < state * stride; i += stride)
 	{
 		real[i] /= state;
 		imag[i] /= state;
 	}
 };
 
-int PrimeFactorDFT::FindFactors(uint length, uint start, uint end, uint* LengthTable)
+/*
+    The inverse transform runs the modules with real and imag swapped,
+    this puts them back in place for the sink.
+*/
+class SwappedSink : public StageSink {
+public:
+    SwappedSink(StageSink* _sink, bool _owned = false) { sink = _sink; owned = _owned; };
+    ~SwappedSink() { if (owned) delete sink; };
+    void Consume(const s64* index, const Data* real, const Data* imag, int length, s64 batch) { sink->Consume(index, imag, real, length, batch); };
+    StageSink* Fork()
+    {
+        StageSink* part = sink->Fork();
+        return part ? new SwappedSink(part, true) : 0;
+    };
+    void Join(StageSink* part) { sink->Join(((SwappedSink*)part)->sink); };
+private:
+    StageSink* sink;
+    bool owned;
+};
+
+void PrimeFactorDFT::forwardFFT(Data* real, Data *imag, StageSink* sink, bool store)
+{
+    if (DFTs.empty()) return;
+    Run(real, imag, false, sink, store);
+}
+
+void PrimeFactorDFT::InverseFFT(Data* real, Data *imag, StageSink* sink, bool store)
+{
+    if (DFTs.empty()) return;
+    SwappedSink swapped(sink);
+    Run(real, imag, true, sink ? &swapped : 0, store);
+}
+
+/*
+    Butterfly j of a stage with count butterflies holds the points n == j
+    (mod count). A butterfly with all inputs 0 leaves 0 in all its points,
+    and a butterfly is needed if one of its points is read later, by a
+    needed butterfly of the next stage or as output.
+    The masks of a stage are filled from the masks of the neighbour stage,
+    point j + m * count is at (j + m * count) % neighbourCount there.
+*/
+static void StageMask(std::vector<bool>& mask, s64 count, s64 factor,
+                      const std::vector<bool>* neighbour, s64 start, s64 length, s64 N)
+{
+    mask.assign(count, false);
+    for (s64 m = 0; m < factor; m++)
+    {
+        s64 n = m * count;
+        if (neighbour) {
+            s64 other = (s64)neighbour->size();
+            s64 idx = n % other;
+            for (s64 j = 0; j < count; j++) {
+                if ((*neighbour)[idx]) mask[j] = true;
+                if (++idx == other) idx = 0;
+            }
+        }
+        else {
+            /* position of n in the range */
+            s64 d = ((n - start) % N + N) % N;
+            for (s64 j = 0; j < count; j++) {
+                if (d < length) mask[j] = true;
+                if (++d == N) d = 0;
+            }
+        }
+    }
+}
+
+s64 PrimeFactorDFT::Prune(s64 inStart, s64 inLength, s64 outStart, s64 outLength, PrunedStages& pruned)
+{
+    pruned.runs.clear();
+    pruned.active = 0;
+    pruned.total = 0;
+    if (state <= 0) return -1;
+
+    std::size_t stages = DFTs.size();
+    std::vector< std::vector<bool> > nonzero(stages);
+    for (std::size_t s = 0; s < stages; s++)
+        StageMask(nonzero[s], state / factors[s], factors[s], s ? &nonzero[s - 1] : 0, inStart, inLength, state);
+
+    pruned.runs.resize(stages);
+    std::vector<bool> needed, next;
+    for (std::size_t s = stages; s-- > 0; )
+    {
+        s64 count = state / factors[s];
+        StageMask(needed, count, factors[s], (s + 1 < stages) ? &next : 0, outStart, outLength, state);
+
+        std::vector<s64>& runs = pruned.runs[s];
+        for (s64 j = 0; j < count; j++) {
+            if (!(needed[j] && nonzero[s][j])) continue;
+            if (runs.size() && runs.back() == j) runs.back() = j + 1;
+            else { runs.push_back(j); runs.push_back(j + 1); }
+            pruned.active++;
+        }
+        pruned.total += count;
+        next.swap(needed);
+    }
+    return pruned.active;
+}
+
+void PrimeFactorDFT::forwardFFT(Data* real, Data *imag, const PrunedStages& pruned)
+{
+    if (pruned.runs.size() != DFTs.size()) return;
+    for (s64 b = 0; b < batchCount; b++, real += batchDistance, imag += batchDistance)
+        for (std::size_t s = 0; s < DFTs.size(); s++)
+            for (std::size_t r = 0; r < pruned.runs[s].size(); r += 2)
+                Stage(s, real, imag, pruned.runs[s][r], pruned.runs[s][r + 1]);
+}
+
+void PrimeFactorDFT::InverseFFT(Data* real, Data *imag, const PrunedStages& pruned)
+{
+    if (pruned.runs.size() != DFTs.size()) return;
+    for (s64 b = 0; b < batchCount; b++, real += batchDistance, imag += batchDistance)
+        for (std::size_t s = 0; s < DFTs.size(); s++)
+            for (std::size_t r = 0; r < pruned.runs[s].size(); r += 2)
+                Stage(s, imag, real, pruned.runs[s][r], pruned.runs[s][r + 1]);
+}
+
+void TopKPeaks::Add(s64 index, Data value, s64 batch)
+{
+    struct Larger {
+        bool operator()(const Peak& a, const Peak& b) const { return a.value > b.value; }
+    };
+
+    if ((int)heap.size() < k) {
+        Peak p = { index, value, batch };
+        heap.push_back(p);
+        std::push_heap(heap.begin(), heap.end(), Larger());
+    }
+    else if (k > 0 && value > heap.front().value) {
+        std::pop_heap(heap.begin(), heap.end(), Larger());
+        heap.back().index = index;
+        heap.back().value = value;
+        heap.back().batch = batch;
+        std::push_heap(heap.begin(), heap.end(), Larger());
+    }
+}
+
+void TopKPeaks::Consume(const s64* index, const Data* real, const Data* imag, int length, s64 batch)
+{
+    for (int i = 0; i < length; i++) {
+        if (limit >= 0 && index[i] >= limit) continue;
+        Data v;
+        switch (component) {
+        case REAL: v = real[i]; break;
+        case IMAG: v = imag[i]; break;
+        default:   v = real[i] * real[i] + imag[i] * imag[i]; break;
+        }
+        if ((int)heap.size() == k && v <= heap.front().value) continue;
+        Add(index[i], v, batch);
+    }
+}
+
+void TopKPeaks::Merge(const TopKPeaks& other)
+{
+    for (std::size_t i = 0; i < other.heap.size(); i++)
+        Add(other.heap[i].index, other.heap[i].value, other.heap[i].batch);
+}
+
+void TopKPeaks::Result(std::vector<Peak>& peaks)
+{
+    peaks = heap;
+    std::sort(peaks.begin(), peaks.end(), [](const Peak& a, const Peak& b) { return a.value > b.value; });
+}
+
+const char* PrimeFactorDFT::KernelVariant()
+{
+#ifdef PFA_FMA_CLONES
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("fma")) return "fma";
+#endif
+    return "generic";
+}
+
+#define HUGEPAGESIZE ((s64)1 << 21)
+#define TOUCHLIMIT  (1 << 16)
+
+/*
+    Writes the block from cpu, -1 is anywhere.
+*/
+static void TouchBlock(Data* buffer, s64 begin, s64 end, int cpu)
+{
+#if defined(NOTWIN) && defined(CPU_SET)
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+#else
+    (void)cpu;
+#endif
+    for (s64 n = begin; n < end; n++) buffer[n] = 0;
+}
+
+bool DataBuffer::Allocate(s64 _count, int flags, int threads)
+{
+    Release();
+    if (_count <= 0) return true;
+
+    s64 bytes = _count * (s64)sizeof(Data);
+#ifdef WIN
+    buffer = (Data*)_aligned_malloc(bytes, DATAALIGN);
+#endif
+#ifdef NOTWIN
+    s64 align = DATAALIGN;
+    if (flags & HUGEPAGES) {
+        align = HUGEPAGESIZE;
+        bytes = (bytes + HUGEPAGESIZE - 1) / HUGEPAGESIZE * HUGEPAGESIZE;
+    }
+    void* p = 0;
+    if (posix_memalign(&p, align, bytes) != 0) p = 0;
+    buffer = (Data*)p;
+#ifdef MADV_HUGEPAGE
+    if (buffer && (flags & HUGEPAGES)) madvise(buffer, bytes, MADV_HUGEPAGE);
+#endif
+#endif
+    if (buffer == 0) return false;
+    count = _count;
+
+    /* the CPUs this thread may run on, their ids need not be 0, 1, ... */
+    std::vector<int> cpus;
+#if defined(NOTWIN) && defined(CPU_SET)
+    cpu_set_t allowed;
+    if ((flags & FIRSTTOUCH) && sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+        for (int c = 0; c < CPU_SETSIZE; c++)
+            if (CPU_ISSET(c, &allowed)) cpus.push_back(c);
+#endif
+
+    int t = 1;
+    if (flags & FIRSTTOUCH) {
+        t = (threads > 0) ? threads : cpus.size() ? (int)cpus.size() : (int)std::thread::hardware_concurrency();
+        if (count < TOUCHLIMIT || t < 2) t = 1;
+    }
+    if (t == 1) {
+        for (s64 n = 0; n < count; n++) buffer[n] = 0;
+        return true;
+    }
+
+    /* thread i of t writes the i-th block from allowed CPU i * cpus / t */
+    std::vector<std::thread> workers;
+    for (int i = 0; i < t; i++) {
+        int cpu = cpus.size() ? cpus[(std::size_t)((s64)i * (s64)cpus.size() / t)] : -1;
+        workers.push_back(std::thread(TouchBlock, buffer, i * count / t, (i + 1) * count / t, cpu));
+    }
+    for (std::size_t i = 0; i < workers.size(); i++) workers[i].join();
+    return true;
+}
+
+void DataBuffer::Release()
+{
+#ifdef WIN
+    if (buffer) _aligned_free(buffer);
+#endif
+#ifdef NOTWIN
+    if (buffer) free(buffer);
+#endif
+    buffer = 0;
+    count = 0;
+}
+
+s64 PrimeFactorPlan::Operations()
+{
+    if (state <= 0) return 0;
+
+    s64 operations = 0;
+    for (std::size_t i = 0; i < factors.size(); i++)
+        operations += (state / factors[i]) * ModuleCostOf(factors[i]).Operations();
+    return operations;
+}
+
+s64 PrimeFactorPlan::FindFactors(s64 length, uint start, uint end, const s64* LengthTable)
 {
     (void)start;
     for(uint i = 0; i < end; i++)
@@ -146,10 +517,10 @@ int PrimeFactorDFT::FindFactors(uint length, uint start, uint end, uint* LengthT
 }
 
 
-int PrimeFactorDFT::FastCalcFactors(uint length, factorSeq& _factors)
+s64 PrimeFactorPlan::FastCalcFactors(s64 length, factorSeq& _factors)
 {
 
-    unsigned int LengthTable[] = {
+    static const s64 LengthTable[] = {
           /* 31, 51, 70, 102, 154, 209,  310, 403, 546,
           these are not used for Schnhage-Strassen  when SSLIMIT is 220, 
           adjust to your liking */ 
@@ -159,11 +530,12 @@ int PrimeFactorDFT::FastCalcFactors(uint length, factorSeq& _factors)
       5275270, 7159295, 10023013, 14318590, 20046026, 30069039, 42955770,
      60138078, 100230130, 150345195, 300690390 };
 
-    uint actualLength = 0;
+    s64 actualLength = 0;
 
     actualLength = FindFactors(length, 0, (sizeof(LengthTable) / sizeof(LengthTable[0])), LengthTable);
 
     _factors.clear();
+    if (actualLength == 0) return 0;
 
     if ((actualLength % 2 )== 0) _factors.push_back(2);
     if ((actualLength % 3) == 0) _factors.push_back(3);
@@ -178,9 +550,9 @@ int PrimeFactorDFT::FastCalcFactors(uint length, factorSeq& _factors)
     return actualLength;
 }
 
-int PrimeFactorDFT::CalcFactors(uint length, factorSeq& _factors, int factorCount)
+s64 PrimeFactorPlan::CalcFactors(s64 length, factorSeq& _factors, int factorCount)
 {
-    std::list<unsigned int> lengthList;
+    std::list<s64> lengthList;
 
 
     for (int ix = 0; ix < 512; ix++) {
@@ -195,7 +567,7 @@ int PrimeFactorDFT::CalcFactors(uint length, factorSeq& _factors, int factorCoun
         }
         if (factorCount && (hw > factorCount)) continue;
 
-        uint tlength = 1;
+        s64 tlength = 1;
         if (ix & 1) tlength *= 2;
         if (ix & 2) tlength *= 3;
         if (ix & 4) tlength *= 5;
@@ -208,9 +580,9 @@ int PrimeFactorDFT::CalcFactors(uint length, factorSeq& _factors, int factorCoun
         lengthList.push_back(tlength);
     }
     lengthList.sort();
-    uint actualLength = 0;
+    s64 actualLength = 0;
 
-    for (std::list<unsigned int>::const_iterator ibegin = lengthList.begin(); 1; ibegin++)
+    for (std::list<s64>::const_iterator ibegin = lengthList.begin(); 1; ibegin++)
         if (ibegin == lengthList.end())  return -1;
         else if (*ibegin >= length)
         {
@@ -248,9 +620,9 @@ int PrimeFactorDFT::CalcFactors(uint length, factorSeq& _factors, int factorCoun
 	The code below is (almost) the original Fortran IV code from Temperton. (Fortran indexes from 1 !)
 
 	*/
-void PrimeFactorDFT::InitRotations()
+void PrimeFactorPlan::InitRotations()
 {
-	int N = 1;
+	s64 N = 1;
 
 	Rotations.clear();
 	for (factorSeq::const_iterator cit = factors.begin(); cit != factors.end(); cit++)  N = *cit * N;
@@ -258,9 +630,9 @@ void PrimeFactorDFT::InitRotations()
 	for (factorSeq::const_iterator cit = factors.begin(); cit != factors.end(); cit++) {
 
 		int IFAC = (int)*cit;
-		int M = N / IFAC;
+		s64 M = N / IFAC;
 		int MU = 0;
-		int MM = 0;
+		s64 MM = 0;
 		for (int J = 1; J < IFAC; J++)
 		{
 			MU = J;
@@ -275,7 +647,7 @@ void PrimeFactorDFT::InitRotations()
 
 }
 
-void PrimeFactorDFT::InitIndices(std::vector<s64>& indices, int fftlength, s64 length)
+void PrimeFactorPlan::InitIndices(std::vector<s64>& indices, int fftlength, s64 length, s64 stride)
 {
     indices.clear();
     indices.resize(fftlength);
@@ -284,25 +656,25 @@ void PrimeFactorDFT::InitIndices(std::vector<s64>& indices, int fftlength, s64 l
 
     while (offset < length)
     {
-        indices[offset % fftlength] = offset;
+        indices[offset % fftlength] = offset * stride;
         offset += (length / fftlength);
     }
 }
 
-void DFT2::Evaluate(Data *real, Data *imag)
+void DFT2::Kernel(Data *real, Data *imag, s64 begin, s64 end, const StageOutput* output)
 {
-    std::vector<s64> ind = indices;
+    std::vector<s64> ind;
+    StartIndices(ind, begin);
 
-    for (int i = 0; i < count; i++)
+    for (s64 i = begin; i < end; i++)
     {
         Data t1real = real[ind[0]] + real[ind[1]];
         Data t1imag = imag[ind[0]] + imag[ind[1]];
         Data t2real = real[ind[0]] - real[ind[1]];
         Data t2imag = imag[ind[0]] - imag[ind[1]];
-        real[ind[0]] = t1real;
-        imag[ind[0]] = t1imag;
-        real[ind[1]] = t2real;
-        imag[ind[1]] = t2imag;
+        Data real_x[2] = { t1real, t2real };
+        Data imag_x[2] = { t1imag, t2imag };
+        Store(real, imag, ind, real_x, imag_x, 2, output);
         //
         //  CRT mapping.
         //
@@ -313,7 +685,7 @@ void DFT2::Evaluate(Data *real, Data *imag)
 #undef FFTLENGTH
 #define FFTLENGTH 3
 
-void DFT3::Evaluate(Data* real, Data *imag)
+PFA_KERNEL void DFT3::Kernel(Data* real, Data *imag, s64 begin, s64 end, const StageOutput* output)
 {
     Data real_x[FFTLENGTH];
     Data imag_x[FFTLENGTH];
@@ -326,9 +698,10 @@ void DFT3::Evaluate(Data* real, Data *imag)
     Data real_v[FFTLENGTH];
     Data imag_v[FFTLENGTH];
 
-    std::vector<s64> ind = indices;
+    std::vector<s64> ind;
+    StartIndices(ind, begin);
 
-    for (int i = 0; i < count; i++)
+    for (s64 i = begin; i < end; i++)
     {
         for (int px = 0; px < FFTLENGTH; px++) {
             real_x[px] = real[ind[px]];
@@ -381,10 +754,7 @@ void DFT3::Evaluate(Data* real, Data *imag)
             imag_x[px] = imag_y[active_op[px]];
         }
 
-        for (int px = 0; px < FFTLENGTH; px++) {
-            real[ind[px]] = real_x[px];
-            imag[ind[px]] = imag_x[px];
-        }
+        Store(real, imag, ind, real_x, imag_x, FFTLENGTH, output);
 
 
         //
@@ -398,7 +768,7 @@ void DFT3::Evaluate(Data* real, Data *imag)
 #undef FFTLENGTH
 #define FFTLENGTH 5
 
-void DFT5::Evaluate(Data* real, Data* imag)
+PFA_KERNEL void DFT5::Kernel(Data* real, Data *imag, s64 begin, s64 end, const StageOutput* output)
 {
     Data real_x[FFTLENGTH];
     Data imag_x[FFTLENGTH];
@@ -409,10 +779,11 @@ void DFT5::Evaluate(Data* real, Data* imag)
     Data imag_y[FFTLENGTH];
     Data real_t, imag_t;
 
-    std::vector<s64> ind = indices;
+    std::vector<s64> ind;
+    StartIndices(ind, begin);
 
 
-    for (int i = 0; i < count; i++)
+    for (s64 i = begin; i < end; i++)
     {
         for (int px = 0; px < FFTLENGTH; px++) {
             real_y[px] = real[ind[px]];
@@ -540,10 +911,7 @@ void DFT5::Evaluate(Data* real, Data* imag)
             imag_x[px] = imag_y[active_op[px]];
         }
 
-        for (int px = 0; px < FFTLENGTH; px++) {
-            real[ind[px]] = real_x[px];
-            imag[ind[px]] = imag_x[px];
-        }
+        Store(real, imag, ind, real_x, imag_x, FFTLENGTH, output);
 
 
         //
@@ -556,7 +924,7 @@ void DFT5::Evaluate(Data* real, Data* imag)
 #undef FFTLENGTH
 #define FFTLENGTH 7
 
-void DFT7::Evaluate(Data* real, Data* imag)
+PFA_KERNEL void DFT7::Kernel(Data* real, Data *imag, s64 begin, s64 end, const StageOutput* output)
 {
     Data real_x[FFTLENGTH];
     Data imag_x[FFTLENGTH];
@@ -569,10 +937,11 @@ void DFT7::Evaluate(Data* real, Data* imag)
     Data imag_y[FFTLENGTH];
     Data real_t, imag_t;
 
-    std::vector<s64> ind = indices;
+    std::vector<s64> ind;
+    StartIndices(ind, begin);
 
 
-    for (int i = 0; i < count; i++)
+    for (s64 i = begin; i < end; i++)
     {
         for (int px = 0; px < FFTLENGTH; px++) {
             real_y[px] = real[ind[px]];
@@ -784,10 +1153,7 @@ void DFT7::Evaluate(Data* real, Data* imag)
             imag_x[px] = imag_y[active_op[px]];
         }
 
-        for (int px = 0; px < FFTLENGTH; px++) {
-            real[ind[px]] = real_x[px];
-            imag[ind[px]] = imag_x[px];
-        }
+        Store(real, imag, ind, real_x, imag_x, FFTLENGTH, output);
 
 
         //
@@ -802,9 +1168,10 @@ void DFT7::Evaluate(Data* real, Data* imag)
 #undef FFTLENGTH
 #define FFTLENGTH 11
 
-void DFT11::Evaluate(Data* real, Data* imag)
+PFA_KERNEL void DFT11::Kernel(Data* real, Data *imag, s64 begin, s64 end, const StageOutput* output)
 {
-    std::vector<s64> ind = indices;
+    std::vector<s64> ind;
+    StartIndices(ind, begin);
 
 
 	Data real_x[FFTLENGTH];
@@ -819,7 +1186,7 @@ void DFT11::Evaluate(Data* real, Data* imag)
     Data real_t, imag_t;
 
 
-	for (int i = 0; i < count; i++)
+	for (s64 i = begin; i < end; i++)
 	{
 
 		/// OBS OBS mangler rotatation lige nu 
@@ -1251,10 +1618,7 @@ void DFT11::Evaluate(Data* real, Data* imag)
             imag_x[px] = imag_y[active_op[px]];
         }
 
-        for (int px = 0; px < FFTLENGTH; px++) {
-            real[ind[px]] = real_x[px];
-            imag[ind[px]] = imag_x[px];
-        }
+        Store(real, imag, ind, real_x, imag_x, FFTLENGTH, output);
 
 
 		//
@@ -1269,9 +1633,10 @@ void DFT11::Evaluate(Data* real, Data* imag)
 
 
 
-void DFT13::Evaluate(Data* real, Data* imag)
+PFA_KERNEL void DFT13::Kernel(Data* real, Data *imag, s64 begin, s64 end, const StageOutput* output)
 {
-    std::vector<s64> ind = indices;
+    std::vector<s64> ind;
+    StartIndices(ind, begin);
 
     Data real_x[FFTLENGTH];
     Data imag_x[FFTLENGTH];
@@ -1283,7 +1648,7 @@ void DFT13::Evaluate(Data* real, Data* imag)
     Data imag_y[FFTLENGTH];
     Data real_t, imag_t;
 
-    for (int i = 0; i < count; i++)
+    for (s64 i = begin; i < end; i++)
     {
 
         for (int px = 0; px < FFTLENGTH; px++) {
@@ -1802,11 +2167,7 @@ void DFT13::Evaluate(Data* real, Data* imag)
             imag_x[px] = imag_y[active_op[px]];
         }
 
-        for (int px = 0; px < FFTLENGTH; px++)
-        {
-            real[ind[px]] = real_x[px];
-            imag[ind[px]] = imag_x[px];
-        }
+        Store(real, imag, ind, real_x, imag_x, FFTLENGTH, output);
         //
         //  CRT mapping.
         //
@@ -1819,9 +2180,10 @@ void DFT13::Evaluate(Data* real, Data* imag)
 #define FFTLENGTH 17
 
 
-void DFT17::Evaluate(Data *real, Data *imag)
+PFA_KERNEL void DFT17::Kernel(Data* real, Data *imag, s64 begin, s64 end, const StageOutput* output)
 {
-    std::vector<s64> ind = indices;
+    std::vector<s64> ind;
+    StartIndices(ind, begin);
 
     Data real_x[FFTLENGTH];
     Data imag_x[FFTLENGTH];
@@ -1833,7 +2195,7 @@ void DFT17::Evaluate(Data *real, Data *imag)
     Data imag_y[FFTLENGTH];
     Data real_t, imag_t;
 
-    for (int i = 0; i < count; i++)
+    for (s64 i = begin; i < end; i++)
     {
 
         for (int px = 0; px < FFTLENGTH; px++) {
@@ -2595,11 +2957,7 @@ void DFT17::Evaluate(Data *real, Data *imag)
             imag_x[px] = imag_y[active_op[px]];
         }
 
-        for (int px = 0; px < FFTLENGTH; px++)
-        {
-            real[ind[px]] = real_x[px];
-            imag[ind[px]] = imag_x[px];
-        }
+        Store(real, imag, ind, real_x, imag_x, FFTLENGTH, output);
 
 
         //
@@ -2614,9 +2972,10 @@ void DFT17::Evaluate(Data *real, Data *imag)
 #undef FFTLENGTH
 #define FFTLENGTH 19
 
-void DFT19::Evaluate(Data* real, Data* imag)
+PFA_KERNEL void DFT19::Kernel(Data* real, Data *imag, s64 begin, s64 end, const StageOutput* output)
 {
-    std::vector<s64> ind = indices;
+    std::vector<s64> ind;
+    StartIndices(ind, begin);
 
 
     Data real_x[FFTLENGTH];
@@ -2629,7 +2988,7 @@ void DFT19::Evaluate(Data* real, Data* imag)
     Data imag_y[FFTLENGTH];
     Data real_t, imag_t;
 
-    for (int i = 0; i < count; i++)
+    for (s64 i = begin; i < end; i++)
     {
 
         for (int px = 0; px < FFTLENGTH; px++) {
@@ -3488,11 +3847,7 @@ void DFT19::Evaluate(Data* real, Data* imag)
         }
 
 
-        for (int px = 0; px < FFTLENGTH; px++)
-        {
-            real[ind[px]] = real_x[px];
-            imag[ind[px]] = imag_x[px];
-        }
+        Store(real, imag, ind, real_x, imag_x, FFTLENGTH, output);
 
 
         //
@@ -3507,9 +3862,10 @@ void DFT19::Evaluate(Data* real, Data* imag)
 #undef FFTLENGTH 
 #define FFTLENGTH 31
 
-void DFT31::Evaluate(Data  *real, Data *imag)
+PFA_KERNEL void DFT31::Kernel(Data* real, Data *imag, s64 begin, s64 end, const StageOutput* output)
 {
-    std::vector<s64> ind = indices;
+    std::vector<s64> ind;
+    StartIndices(ind, begin);
 
 
     Data real_x[FFTLENGTH];
@@ -3522,7 +3878,7 @@ void DFT31::Evaluate(Data  *real, Data *imag)
     Data imag_y[FFTLENGTH];
     Data real_t, imag_t;
 
-    for (int i = 0; i < count; i++)
+    for (s64 i = begin; i < end; i++)
     {
 
         for (int px = 0; px < FFTLENGTH; px++) {
@@ -5311,11 +5667,7 @@ void DFT31::Evaluate(Data  *real, Data *imag)
             imag_x[px] = imag_y[active_op[px]];
         }
 
-        for (int px = 0; px < FFTLENGTH; px++)
-        {
-            real[ind[px]] = real_x[px];
-            imag[ind[px]] = imag_x[px];
-        }
+        Store(real, imag, ind, real_x, imag_x, FFTLENGTH, output);
 
         //
         //  CRT mapping.
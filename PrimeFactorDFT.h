@@ -19,6 +19,8 @@ Inspiration originally from
 					C. Sidney Burrus
 					Ivan Selesnick   at RICE University
 */
+#include <functional>
+#include <future>
 #include <vector>
 
 #ifdef OS_WINDOWS    // windows
@@ -33,47 +35,198 @@ typedef  uint64_t  u64;
 typedef  int64_t  s64;
 #endif
 
+/*
+*  The Winograd modules are compiled twice where the compiler supports it: a generic
+*  version and one targeting FMA3, where the MUL/ADD pairs are contracted into
+*  fused multiply-add. The version is picked at load time from the CPU features.
+*  Define PFA_NO_FMA to get the generic version only.
+*/
+#if defined(__has_attribute) && !defined(PFA_NO_FMA)
+#if __has_attribute(target_clones) && (defined(__x86_64__) || defined(__i386__))
+#define PFA_FMA_CLONES
+#endif
+#endif
+
+#ifdef PFA_FMA_CLONES
+#define PFA_KERNEL __attribute__((target_clones("fma", "default")))
+#else
+#define PFA_KERNEL
+#endif
+
 typedef unsigned int uint;
 typedef std::vector<uint> factorSeq;
+/*
+*  The Winograd constants are given to 34 digits, so building with PFA_LONG_DOUBLE
+*  runs the whole transform in extended precision (64 bit mantissa on x86).
+*/
+#ifdef PFA_LONG_DOUBLE
+typedef long double Data;
+#else
 typedef double Data;
+#endif
 
 
-class BasicDFT {
-
-public:
-	BasicDFT() { count = 0; };
-	virtual ~BasicDFT() { indices.clear(); }
-	virtual void Evaluate(Data *read, Data *imag) = 0;
+/*
+*  The index walk shared by all modules: count butterflies, each one a set of
+*  points n == j (mod length/factor), stored at position n % factor of the module.
+*  Point n is at n * stride in memory.
+*/
+class CRTIndices {
 
 protected:
+	CRTIndices() { count = 0; stride = 1; };
+	~CRTIndices() { indices.clear(); }
+
 	std::vector<s64> indices;
 	s64 count;
+	s64 stride;
 
 	void IncIndices(std::vector<s64>& ind)
 	{
 		s64 tmp = ind[ind.size() - 1];
 		for (std::size_t i = ind.size() - 1; i > 0; i--)
 		{
-			ind[i] = ind[i - 1] + 1;
+			ind[i] = ind[i - 1] + stride;
 		}
-		ind[0] = tmp + 1;
+		ind[0] = tmp + stride;
 	}
 
+	/*
+	*  The indices of butterfly j without walking there,
+	*  ind_j[r] = ind_0[(r - j) mod factor] + j * stride.
+	*/
+	void StartIndices(std::vector<s64>& ind, s64 j)
+	{
+		std::size_t p = indices.size();
+		std::size_t shift = (std::size_t)(j % (s64)p);
+		ind.resize(p);
+		for (std::size_t r = 0; r < p; r++)
+		{
+			ind[r] = indices[(r + p - shift) % p] + j * stride;
+		}
+	}
+
+
+};
+
+/*
+*  Receives the outputs of the last stage of a transform, one call per
+*  butterfly with its length points at index[i], i < length. The indices are
+*  the points of the transform, 0 <= index[i] < length of the transform,
+*  whatever the stride, and batch is the transform of the batch they are from.
+*/
+class StageSink {
+public:
+	virtual ~StageSink() {};
+	virtual void Consume(const s64* index, const Data* real, const Data* imag, int length, s64 batch) = 0;
+
+	/*
+	*  A new sink for one chunk of the last stage when it runs on a pool,
+	*  handed back to Join and deleted when the stage is done. The default 0
+	*  keeps the stage on the calling thread.
+	*/
+	virtual StageSink* Fork() { return 0; };
+	virtual void Join(StageSink* part) { (void)part; };
+};
+
+struct Peak {
+	s64 index;
+	Data value;
+	/* the transform of the batch */
+	s64 batch;
+};
+
+/*
+*  The k largest values among the outputs with index < limit (all if limit < 0),
+*  the value being real^2 + imag^2, real or imag. Peaks found by separate
+*  instances are combined with Merge, a pooled last stage has one per chunk.
+*/
+class TopKPeaks : public StageSink {
+public:
+	enum { POWER, REAL, IMAG };
+
+	TopKPeaks(int _k, int _component = POWER, s64 _limit = -1) { k = _k; component = _component; limit = _limit; };
+	~TopKPeaks() {};
+
+	void Consume(const s64* index, const Data* real, const Data* imag, int length, s64 batch);
+	void Merge(const TopKPeaks& other);
+	StageSink* Fork() { return new TopKPeaks(k, component, limit); };
+	void Join(StageSink* part) { Merge(*(TopKPeaks*)part); };
+	void Clear() { heap.clear(); };
+	/* best first */
+	void Result(std::vector<Peak>& peaks);
+
+private:
+	void Add(s64 index, Data value, s64 batch);
+
+	int k;
+	int component;
+	s64 limit;
+	/* min heap, the smallest of the k largest on top */
+	std::vector<Peak> heap;
+};
+
+/*
+*  Where the last stage of a transform with a sink puts the outputs of a
+*  butterfly: to sink, and to real, imag if store. It goes along with the
+*  call, the modules keep nothing of a transform.
+*/
+struct StageOutput {
+	StageSink* sink;
+	bool store;
+	s64 batch;
+};
+
+class BasicDFT : protected CRTIndices {
+
+public:
+	BasicDFT() {};
+	virtual ~BasicDFT() { indices.clear(); }
+	virtual void Evaluate(Data *read, Data *imag) = 0;
+	/* the butterflies begin <= j < end only */
+	virtual void Evaluate(Data *real, Data *imag, s64 begin, s64 end) = 0;
+	/* as above, the outputs go to output */
+	virtual void Evaluate(Data *real, Data *imag, s64 begin, s64 end, const StageOutput* output) = 0;
+
+	s64 Butterflies() { return count; };
+
+protected:
+	void Store(Data* real, Data* imag, std::vector<s64>& ind, Data* real_x, Data* imag_x, int length, const StageOutput* output)
+	{
+		if (output) {
+			if (stride == 1) output->sink->Consume(ind.data(), real_x, imag_x, length, output->batch);
+			else {
+				/* the sink gets points, not offsets */
+				s64 points[32];
+				for (int px = 0; px < length; px++) points[px] = ind[px] / stride;
+				output->sink->Consume(points, real_x, imag_x, length, output->batch);
+			}
+			if (!output->store) return;
+		}
+		for (int px = 0; px < length; px++) {
+			real[ind[px]] = real_x[px];
+			imag[ind[px]] = imag_x[px];
+		}
+	}
 
 };
 
 class DFT2 : protected BasicDFT {
 public:
-	DFT2(int  Rotation, s64 Count, std::vector<s64> startIndices)
+	DFT2(int  Rotation, s64 Count, std::vector<s64> startIndices, s64 Stride = 1)
 	{
 		count = Count;
+		stride = Stride;
 		(void) Rotation;
 		indices = startIndices;
 
 	};
 	~DFT2() { indices.clear(); }
-	void Evaluate(Data* real, Data* imag);
+	void Evaluate(Data* real, Data* imag) { Kernel(real, imag, 0, count, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end) { Kernel(real, imag, begin, end, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output) { Kernel(real, imag, begin, end, output); }
 private:
+	void Kernel(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output);
 
 };
 
@@ -83,18 +236,19 @@ private:
 
 class DFT3 : protected BasicDFT {
 public:
-	DFT3(int  Rotation, s64 Count, std::vector<s64> startIndices) :
+	DFT3(int  Rotation, s64 Count, std::vector<s64> startIndices, s64 Stride = 1) :
 		u{
 		/*real*/
-		-1.500000000000000,
+		-1.500000000000000000000000000000000L,
 		/* imag */
-		0.866025403784439},
+		0.866025403784438646763723170752936L},
 		op{ 0, 2, 1},
 		ip{ 0, 1, 2} // not used
 	{
 		int Rotations[FFTLENGTH] = { 0, 1, 2};
 
 		count = Count;
+		stride = Stride;
 		indices = startIndices;
 
 		for (int i = 0; i < FFTLENGTH; i++)
@@ -111,8 +265,11 @@ public:
 	};
 	~DFT3() { indices.clear(); }
 
-	void Evaluate(Data *real, Data *imag);
+	void Evaluate(Data* real, Data* imag) { Kernel(real, imag, 0, count, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end) { Kernel(real, imag, begin, end, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output) { Kernel(real, imag, begin, end, output); }
 private:
+	void Kernel(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output);
 	const Data  u[2];
 	const unsigned int  ip[FFTLENGTH];
 	const unsigned int	op[FFTLENGTH];
@@ -125,15 +282,15 @@ private:
 
 class DFT5 : protected BasicDFT {
 public:
-	DFT5(int  Rotation, s64 Count, std::vector<s64> startIndices):
+	DFT5(int  Rotation, s64 Count, std::vector<s64> startIndices, s64 Stride = 1):
 		u{ 
 		/* real */
-		-1.250000000000000,
-		-0.559016994374947,
+		-1.250000000000000000000000000000000L,
+		-0.559016994374947424102293417182819L,
 		/* imaginary*/
-		-1.538841768587627,
-		-0.363271264002681,
-		0.951056516295154 
+		-1.538841768587626701285145288018455L,
+		-0.363271264002680442947733378740309L,
+		0.951056516295153572116439333379382L 
 	},
 	ip{ 0, 1, 2, 4, 3 },
 	op{ 0, 4, 1, 3, 2 }
@@ -141,6 +298,7 @@ public:
 		int Rotations[FFTLENGTH] = { 0, 1, 2, 3, 4 };
 
 		count = Count;
+		stride = Stride;
 		indices = startIndices;
 
 		for (int i = 0; i < FFTLENGTH; i++)
@@ -157,8 +315,11 @@ public:
 	};
 	~DFT5() { indices.clear(); }
 
-	void Evaluate(Data* real, Data* imag);
+	void Evaluate(Data* real, Data* imag) { Kernel(real, imag, 0, count, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end) { Kernel(real, imag, begin, end, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output) { Kernel(real, imag, begin, end, output); }
 private:
+	void Kernel(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output);
 	const Data  u[5];
 	const unsigned int  ip[FFTLENGTH];
 	const unsigned int	op[FFTLENGTH];
@@ -171,26 +332,27 @@ private:
 
 class DFT7 : protected BasicDFT {
 public:
-	DFT7(int  Rotation, s64 Count, std::vector<s64> startIndices) :
+	DFT7(int  Rotation, s64 Count, std::vector<s64> startIndices, s64 Stride = 1) :
 		u{ 
 		/* real */
-		-1.166666666666667,
+		-1.166666666666666666666666666666667L,
 		/* Imag */
-		0.440958551844098,
+		0.440958551844098431750269292273210L,
 		/* real */
-	   -0.678447933946105,
-		0.846010735815048,
-	   -0.055854267289648,
+	   -0.678447933946104721947199755010650L,
+		0.846010735815047934813907448501035L,
+	   -0.055854267289647737622235897830128L,
 		/* Imag */
-	   -1.408811651299382,
-	   -0.193096429713794,
-		0.533969360337725 },
+	   -1.408811651299381727493900015842290L,
+	   -0.193096429713793798309687156319873L,
+		0.533969360337725175267862390720721L },
 		ip{ 0, 1, 4, 2, 6, 3, 5 },
 		op{ 0, 6, 5, 1, 4, 2, 3 }
 	{
 		int Rotations[FFTLENGTH] = { 0, 1, 2, 3, 4, 5, 6 };
 
 		count = Count;
+		stride = Stride;
 		indices = startIndices;
 
 		for (int i = 0; i < FFTLENGTH; i++)
@@ -207,8 +369,11 @@ public:
 	};
 	~DFT7() { indices.clear(); }
 
-	void Evaluate(Data* real, Data* imag);
+	void Evaluate(Data* real, Data* imag) { Kernel(real, imag, 0, count, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end) { Kernel(real, imag, begin, end, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output) { Kernel(real, imag, begin, end, output); }
 private:
+	void Kernel(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output);
 	const Data  u[8];
 	const unsigned int  ip[FFTLENGTH];
 	const unsigned int	op[FFTLENGTH];
@@ -219,38 +384,39 @@ private:
 #define FFTLENGTH 11
 class DFT11 : protected BasicDFT {
 public:
-	DFT11(int  Rotation, s64 Count, std::vector<s64> startIndices) :
+	DFT11(int  Rotation, s64 Count, std::vector<s64> startIndices, s64 Stride = 1) :
 		op{ 0, 10, 1, 8, 7, 9, 4, 2, 3, 6, 5 },
 		ip{ 0,  1, 9, 4, 3,	5, 10,2, 7,	8, 6 },
 		u{
-		 -1.100000000000000,
-		0.331662479035540,
+		 -1.100000000000000000000000000000000L,
+		0.331662479035539984911493273667069L,
 		/* pure real*/
-		0.253097611605959,
-		-1.288200610773679,
-		0.304632239669212, 
-		-0.391339615511917,
-		-2.871022253392850,
-		1.374907986616384,
-		0.817178135341212,
-		1.800746506445679,
-		 -0.859492973614498,
+		0.253097611605959240139623833245959L,
+		-1.288200610773678635139047302135772L,
+		0.304632239669212325833442984600034L, 
+		-0.391339615511917506114037888760214L,
+		-2.871022253392850048338378927681612L,
+		1.374907986616383815419642206295951L,
+		0.817178135341212249446575388449958L,
+		1.800746506445678558752179705985695L,
+		 -0.859492973614497389890368057066328L,
 		/* pure imaginary */
-		 -2.373470454748280,
-		 -0.024836393087493,
-		 0.474017017512829,
-		 0.742183927770612 ,
-		 1.406473309094609,
-		 -1.191364552195948,
-		 0.708088885039503 ,
-		 0.258908260614168 ,
-		 -0.049929922194110
+		 -2.373470454748279689850425349481475L,
+		 -0.024836393087493435794161845167700L,
+		 0.474017017512828586062617928625728L,
+		 0.742183927770612918854677214967618L ,
+		 1.406473309094608770789533188079298L,
+		 -1.191364552195948069123133298425645L,
+		 0.708088885039503034664674122430102L ,
+		 0.258908260614167884396218038972075L ,
+		 -0.049929922194110287200075358320452L
 		}
 	{
 
 		int Rotations[FFTLENGTH] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
 
 		count = Count;
+		stride = Stride;
 		indices = startIndices;
 
 		for (int i = 0; i < FFTLENGTH; i++)
@@ -269,9 +435,12 @@ public:
 	
 	~DFT11() { indices.clear(); }
 
-	void Evaluate(Data* real, Data* imag);
+	void Evaluate(Data* real, Data* imag) { Kernel(real, imag, 0, count, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end) { Kernel(real, imag, begin, end, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output) { Kernel(real, imag, begin, end, output); }
 
 private:
+	void Kernel(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output);
 
 	const Data  u[20];
 	const unsigned int  ip[FFTLENGTH];
@@ -286,36 +455,37 @@ private:
 class DFT13 : protected BasicDFT {
 
 public:
-	DFT13(int  Rotation, s64 Count, std::vector<s64> startIndices) :
+	DFT13(int  Rotation, s64 Count, std::vector<s64> startIndices, s64 Stride = 1) :
 		op{ 0,12,1,10,5,3,2,8,9,11,4,7,6 },
 		ip{ 0,1,3,9,5,2,6,12,10,4,8,11,7 },
 		u{
-		-1.083333333333333,
-		-0.300462606288666,
-		-0.749279330626139,
+		-1.083333333333333333333333333333333L,
+		-0.300462606288665774426601772289208L,
+		-0.749279330626139026374046342384718L,
 		/* imag */
-		0.401002128321867,
-		0.174138601152136,
+		0.401002128321867216362724752526189L,
+		0.174138601152135905005660794929265L,
 		/* real */
-		1.007074065727533,
-		0.731245990975348,
-		-0.579440018900960,
-		0.531932498429674,
-		-0.508814921720398,
-		-0.007705858903092,
+		1.007074065727533254493747707736934L,
+		0.731245990975348225196182545603778L,
+		-0.579440018900960493229976751113571L,
+		0.531932498429674575175042127684372L,
+		-0.508814921720397296673830869011340L,
+		-0.007705858903092426167070419557677L,
 		/* imag  */
-		 -2.511393318389568,
-		-1.823546408682421,
-		1.444979909023996,
-		-1.344056915177370,
-		-0.975932420775946,
-		0.773329778651105,
-		1.927725116783469,
-		1.399739414729183,
-		-1.109154843837551
+		 -2.511393318389567443671399946509521L,
+		-1.823546408682420804323831701377490L,
+		1.444979909023996082665077215962337L,
+		-1.344056915177370188809672552151181L,
+		-0.975932420775945933867768168564381L,
+		0.773329778651105374225813573571854L,
+		1.927725116783468816240536249330351L,
+		1.399739414729183369095799934970936L,
+		-1.109154843837550728445445394767095L
 		} 
 	{
 		count = Count;
+		stride = Stride;
 		indices = startIndices;
 
 		int Rotations[FFTLENGTH] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
@@ -333,8 +503,11 @@ public:
 	}
 	~DFT13() { indices.clear(); }
 
-	void Evaluate(Data* real, Data* imag);
+	void Evaluate(Data* real, Data* imag) { Kernel(real, imag, 0, count, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end) { Kernel(real, imag, begin, end, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output) { Kernel(real, imag, begin, end, output); }
 private:
+	void Kernel(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output);
 
 	const Data  u[20];
 
@@ -350,57 +523,58 @@ private:
 class DFT17 : protected BasicDFT {
 
 public:
-	DFT17(int  Rotation, s64 Count, std::vector<s64> startIndices) :
+	DFT17(int  Rotation, s64 Count, std::vector<s64> startIndices, s64 Stride = 1) :
 		u{
 		/* real */
-			-1.062500000000000,
-			-0.257694101601104,
-			0.723407977286057,
-			-0.089055591620606,
-			-0.317176192832725,
-			0.924380996081242,
-			0.676798496730885,
-			-0.440889073481754,
-			-1.517002366671939,
-			-0.797601020823318,
-			1.281092943422807,
-			0.296310685295348,
-			0.060401262046216,
-			-0.420101934970527,
+			-1.062500000000000000000000000000000L,
+			-0.257694101601103784363838115998380L,
+			0.723407977286056601835073306459372L,
+			-0.089055591620606370749982539480061L,
+			-0.317176192832725115542545383489655L,
+			0.924380996081242989382054811419801L,
+			0.676798496730885226426499043457289L,
+			-0.440889073481753542436509185030395L,
+			-1.517002366671939035759963828124346L,
+			-0.797601020823317904824428343308046L,
+			1.281092943422807351769973969697452L,
+			0.296310685295348023188954508352273L,
+			0.060401262046216339198964649925378L,
+			-0.420101934970526904666732392333528L,
 			/* imag */
-			1.462686052158509,
-			 2.709842506062867,
-			 -1.124438635937869,
-			 -1.808356521480244,
-			 2.958485673330231 ,
-			 0.222952651355246 ,
-			 -0.906077574510765 ,
-			 -2.491481444635763 ,
-			 0.634492510107882 ,
-			 2.681907643666417 ,
-			 -1.890642422994411 ,
-			 0.499530681019060 ,
-			 0.524082025323152 ,
-			 -1.205277132872840 ,
-			 0.867029716652200 ,
-			 0.032526452324592 ,
-			 1.423638194299944 ,
-			 -1.356975842482187 ,
-			 -2.072296847912463 ,
-			 -0.409600041534228 ,
-			 0.312453977459405 ,
-			 0.642137248078546 ,
-			 -0.876604270228695 ,
-			 -0.544991184003723 ,
-			 0.436775561093086 ,
-			 0.533921625167910 ,
-			 0.361241666187153 
+			1.462686052158508904694736760160044L,
+			 2.709842506062866142652375132356491L,
+			 -1.124438635937868453264759655526749L,
+			 -1.808356521480243659548239646154383L,
+			 2.958485673330230725892601533097624L ,
+			 0.222952651355245970160624169324641L ,
+			 -0.906077574510765276214673896377343L ,
+			 -2.491481444635762965602289373207086L ,
+			 0.634492510107881573126476582721782L ,
+			 2.681907643666416768724420679379505L ,
+			 -1.890642422994411979247997725957454L ,
+			 0.499530681019059927328805023042760L ,
+			 0.524082025323151461441570000630479L ,
+			 -1.205277132872841041907599806917510L ,
+			 0.867029716652200590477622702284215L ,
+			 0.032526452324592167038492863152221L ,
+			 1.423638194299944218957685566066915L ,
+			 -1.356975842482187470615905775089182L ,
+			 -2.072296847912462836709578719769774L ,
+			 -0.409600041534227081702188703199519L ,
+			 0.312453977459404262967977316241994L ,
+			 0.642137248078546099053334822761952L ,
+			 -0.876604270228694841992500863090057L ,
+			 -0.544991184003723280319123435804428L ,
+			 0.436775561093086554588090516612561L ,
+			 0.533921625167909373322301903570085L ,
+			 0.361241666187152948744714596183700L 
 
 	},
 		ip{ 0,1,3,9,10,13,5,15,11,16,14,8,7,4,12,2,6 },
 		op{ 0,16,14,1,12,5,15,11,10,2,3,7,13,4,9,6,8 }
 	{
 		count = Count;
+		stride = Stride;
 		indices = startIndices;
 
 		int Rotations[FFTLENGTH] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
@@ -417,9 +591,12 @@ public:
 			active_op[i] = op[Rotations[i]];
 	}
 	~DFT17() { indices.clear(); }
-	void Evaluate(Data* real, Data* imag);
+	void Evaluate(Data* real, Data* imag) { Kernel(real, imag, 0, count, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end) { Kernel(real, imag, begin, end, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output) { Kernel(real, imag, begin, end, output); }
 
 private:
+	void Kernel(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output);
 
 	const Data u[41];
 	const unsigned int  ip[FFTLENGTH];
@@ -435,57 +612,58 @@ private:
 class DFT19 : protected BasicDFT {
 
 public:
-	DFT19(int  Rotation, s64 Count, std::vector<s64> startIndices) :
+	DFT19(int  Rotation, s64 Count, std::vector<s64> startIndices, s64 Stride = 1) :
 		u{
 			/* real */
-			-1.055555555555556,
+			-1.055555555555555555555555555555556L,
 			/* imag */
-			 0.242161052418926,
+			 0.242161052418926308457610110214423L,
 			/* real */
-			0.798693520987127,
-			0.177211053261099,
-			-0.325301524749409,
+			0.798693520987126943842486632874384L,
+			0.177211053261099071687906637224263L,
+			-0.325301524749408671843464423366216L,
 			/* imag */
-			-0.834854293606883,
-			-0.488430732011460 ,
-			0.441095008539447,
+			-0.834854293606882764410051216759663L,
+			-0.488430732011460061016227069175184L ,
+			0.441095008539447608475426095311615L,
 			/* real */
-			0.435557826755211, 
-			0.231321070206014, 
-			-0.421744310987423,
-			-0.002942234699835,
-			0.822164874728519, 
-			-1.524433450111895,
-			-0.208976399520928,
-			0.861151390434984, 
-			0.242730955603080, 
-			-3.304023490019812,
-			0.362958541118895, 
-			-0.007448223561695,
-			-0.146469026482520,
-			-0.079929573634415,
-			0.827286205097097, 
+			0.435557826755210017572409224786438L, 
+			0.231321070206015008468727351879066L, 
+			-0.421744310987423400346080524528375L,
+			-0.002942234699834901187837649434226L,
+			0.822164874728519726968423098673383L, 
+			-1.524433450111895533141427070357706L,
+			-0.208976399520928001104421727504432L,
+			0.861151390434984528282910013809678L, 
+			0.242730955603079806650832103118830L, 
+			-3.304023490019811911067001823591091L,
+			0.362958541118895171856339281857089L, 
+			-0.007448223561695669121435208124878L,
+			-0.146469026482520375978943163093768L,
+			-0.079929573634414968487664817894868L,
+			0.827286205097097394699526241639236L, 
 			/* imag */
-			 0.490936114006330,
-			 0.364666773063770,
-			 -0.318086136404994,
-			 -0.314562985092245,
-			 5.737605861191472,
-			 1.814966178076640,
-			 -0.151292354260379,
-			 0.313346892339940,
-			 -0.143269744887002,
-			 2.935067055771071,
-			 -0.768634097360990,
-			 -0.071124806267797,
-			 0.001579748021685,
-			 0.152610909993082,
-			 -2.890890972320848
+			 0.490936114006330225846200254943890L,
+			 0.364666773063769604526684421237754L,
+			 -0.318086136404993839437464094127591L,
+			 -0.314562985092245233573695214631593L,
+			 5.737605861191471517865600283601393L,
+			 1.814966178076639501248052768272470L,
+			 -0.151292354260378780827170707180855L,
+			 0.313346892339940057785862916872260L,
+			 -0.143269744887002353581331776276478L,
+			 2.935067055771072902935071473440469L,
+			 -0.768634097360989909031417674405453L,
+			 -0.071124806267796941233171238018967L,
+			 0.001579748021684593883867059085110L,
+			 0.152610909993082529051675663636024L,
+			 -2.890890972320848140266890585680620L
 	},
 	ip{ 0,1,17,4,11,16,	6,7,5,9,18,2,15,8,	3,13,12,14,10 },
 	op{ 0,18,1,4,11,16,	14,	15,	3,17,8,	12,	6,5,7,2,13,	10,	9 }
 	{
 		count = Count;
+		stride = Stride;
 		indices = startIndices;
 
 		int Rotations[FFTLENGTH] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18 };
@@ -503,8 +681,11 @@ public:
 	}
 	~DFT19() { indices.clear(); }
 
-	void Evaluate(Data* real, Data* imag);
+	void Evaluate(Data* real, Data* imag) { Kernel(real, imag, 0, count, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end) { Kernel(real, imag, begin, end, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output) { Kernel(real, imag, begin, end, output); }
 private:
+	void Kernel(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output);
 	const Data u[39];
 	const unsigned int  ip[FFTLENGTH];
 	const unsigned int	op[FFTLENGTH];
@@ -519,103 +700,104 @@ private:
 class DFT31 : protected BasicDFT {
 
 public:
-	DFT31(int  Rotation, s64 Count, std::vector<s64> startIndices) :
+	DFT31(int  Rotation, s64 Count, std::vector<s64> startIndices, s64 Stride = 1) :
 		op{ 0,30,29,1,28,25,5,18,27,22,24,8,4,6,17,11,26,2,21,19,23,9,7,12,3,20,10,13,16,14,15 },
 		ip{ 0,1,16,8,4,2,25,28,14,7,19,5,18,9,20,10,30,15,23,27,29,6,3,17,24,12,26,13,22,11,21 },
 		u{ 
 		/* real */
-		-1.033333333333333,	/*  0 */
+		-1.033333333333333333333333333333333L,	/*  0 */
 		/* imag */
-		0.185592145427667 ,	/*  1 */
+		0.185592145427667397403982376630618L ,	/*  1 */
 		/* real */
-		 0.251026872929094, 	/*  2 */
-		 0.638094290379888, 	/*  3 */
-		 -0.296373721102994,	/*  4 */
+		 0.251026872929094175322677333303375L, 	/*  2 */
+		 0.638094290379888237341125542413432L, 	/*  3 */
+		 -0.296373721102994137554600958572269L,	/*  4 */
 		/* imag */
-		 -0.462201919825109,	/*  5 */
-		 0.155909426230360 ,	/*  6 */
-		 0.102097497864916 ,	/*  7 */
+		 -0.462201919825108579466283849397624L,	/*  5 */
+		 0.155909426230360388401557646847790L ,	/*  6 */
+		 0.102097497864916063688242067516611L ,	/*  7 */
 		/* real */
-		 -0.100498239164838, 	/*  8 */
-		 -0.217421331841463, 	/*  9 */
-		 -0.325082164955763, 	/*  10 */
-		 0.798589508696894, 	/*  11 */
-		 -0.780994042074251,	/*  12 */
-		  -0.256086011899669,	/*  13 */
-		 0.169494392220932,	/*  14 */
-		 0.711997889018157, 	/*  15 */
-		 -0.060064820876732,	/*  16 */
+		 -0.100498239164837935109903208950367L, 	/*  8 */
+		 -0.217421331841463109588837248585372L, 	/*  9 */
+		 -0.325082164955762506922404205387800L, 	/*  10 */
+		 0.798589508696894402005593259283153L, 	/*  11 */
+		 -0.780994042074250994477249463079179L,	/*  12 */
+		  -0.256086011899668785494351805309981L,	/*  13 */
+		 0.169494392220931656537955609028187L,	/*  14 */
+		 0.711997889018157273049197063001359L, 	/*  15 */
+		 -0.060064820876731527434079332266353L,	/*  16 */
 		/* imag */
-		 -1.235197570427205 ,	/*  17 */
-		 -0.271691369288525 ,	/*  18 */
-		 0.541789612349592 ,	/*  19 */
-		 0.329410560797314 ,	/*  20 */
-		 1.317497505049809 ,	/*  21 */
-		 -0.599508803858381 ,	/*  22 */
-		 0.093899154219231 ,	/*  23 */
-		 -0.176199088841836 ,	/*  24 */
-		 0.028003825226279 ,	/*  25 */
+		 -1.235197570427205098210164907133686L ,	/*  17 */
+		 -0.271691369288524943916668193727687L ,	/*  18 */
+		 0.541789612349592345507667446848337L ,	/*  19 */
+		 0.329410560797313769056489705034710L ,	/*  20 */
+		 1.317497505049809335691147155994356L ,	/*  21 */
+		 -0.599508803858381170647488958155360L ,	/*  22 */
+		 0.093899154219231582055008502129990L ,	/*  23 */
+		 -0.176199088841835819535990750990659L ,	/*  24 */
+		 0.028003825226278612524160752033538L ,	/*  25 */
 		/* real */
-		 1.316699050305790, 	/*  26 */
-		 1.330315270540553, 	/*  27 */
-		 -0.385122753006171,	/*  28 */
-		 -2.958666546021397,	/*  29 */
-		 -2.535301995146201,	/*  30 */
-		 2.013474028487015, 	/*  31 */
-		 1.081897731187396, 	/*  32 */
-		 0.136705213653014, 	/*  33 */
-		 -0.569390844064251,	/*  34 */
-		 -0.262247009112805,	/*  35 */
-		 2.009855570455675, 	/*  36 */
-		 -1.159348599757857,	/*  37 */
-		 0.629367699727360, 	/*  38 */
-		 1.229312102919654, 	/*  39 */
-		 -1.479874670425178,	/*  40 */
-		 -0.058279061554516,	/*  41 */
-		 -0.908786032252333,	/*  42 */
-		 0.721257672797977, 	/*  43 */
-		 -0.351484013730995,	/*  44 */
-		 -1.113390280332076,	/*  45 */
-		 0.514823784254676, 	/*  46 */
-		 0.776432948764679, 	/*  47 */
-		 0.435329964075516, 	/*  48 */
-		 -0.177866452687279,	/*  49 */
-		 -0.341206223210960,	/*  50 */
-		 0.257360272866440, 	/*  51 */
-		 -0.050622276244575,	/*  52 */
+		 1.316699050305790657150867540864623L, 	/*  26 */
+		 1.330315270540553399391822887713982L, 	/*  27 */
+		 -0.385122753006171719764011582295680L,	/*  28 */
+		 -2.958666546021396717215923633623986L,	/*  29 */
+		 -2.535301995146201177925568974719802L,	/*  30 */
+		 2.013474028487015037588112328205684L, 	/*  31 */
+		 1.081897731187396100201256369636741L, 	/*  32 */
+		 0.136705213653014420573445064218439L, 	/*  33 */
+		 -0.569390844064250767719760435953037L,	/*  34 */
+		 -0.262247009112805327834131540549899L,	/*  35 */
+		 2.009855570455674486982367904389636L, 	/*  36 */
+		 -1.159348599757857111607309529211171L,	/*  37 */
+		 0.629367699727360590762169977496533L, 	/*  38 */
+		 1.229312102919653756600764481556222L, 	/*  39 */
+		 -1.479874670425177966137228352674998L,	/*  40 */
+		 -0.058279061554515526695787282913929L,	/*  41 */
+		 -0.908786032252332902070845658092395L,	/*  42 */
+		 0.721257672797976701302234164578498L, 	/*  43 */
+		 -0.351484013730995109772245333438241L,	/*  44 */
+		 -1.113390280332075962124730264034540L,	/*  45 */
+		 0.514823784254676277123773703835617L, 	/*  46 */
+		 0.776432948764678708817917885375818L, 	/*  47 */
+		 0.435329964075515807108268164387860L, 	/*  48 */
+		 -0.177866452687279023816961325176895L,	/*  49 */
+		 -0.341206223210960191168489695574271L,	/*  50 */
+		 0.257360272866439493832466864624652L, 	/*  51 */
+		 -0.050622276244575311194157909541821L,	/*  52 */
 		/* imag */
-		 -2.745673340229639 ,	/*  53 */
-		 2.685177424507523 ,	/*  54 */
-		 0.880463026400118 ,	/*  55 */
-		 -5.028851220636894 ,	/*  56 */
-		 -0.345528375980267 ,	/*  57 */
-		 1.463210769729252 ,	/*  58 */
-		 3.328421083558774 ,	/*  59 */
-		 -0.237219367348867 ,	/*  60 */
-		 -1.086975102467855 ,	/*  61 */
-		 -1.665522956385442 ,	/*  62 */
-		 1.628826188810638 ,	/*  63 */
-		 0.534088072762272 ,	/*  64 */
-		 -3.050496586573981 ,	/*  65 */
-		 -0.209597199290132 ,	/*  66 */
-		 0.887582325001072 ,	/*  67 */
-		 2.019017208624242 ,	/*  68 */
-		 -0.143897052948668 ,	/*  69 */
-		 -0.659358110687783 ,	/*  70 */
-		 1.470398765538361 ,	/*  71 */
-		 -1.438001204439387 ,	/*  72 */
-		 -0.471517033054130 ,	/*  73 */
-		 2.693115935736959 ,	/*  74 */
-		 0.185041858423467 ,	/*  75 */
-		 -0.783597698243441 ,	/*  76 */
-		 -1.782479430727672 ,	/*  77 */
-		 0.127038806765845 ,	/*  78 */
-		 0.582111071051880 	/*  79 */
+		 -2.745673340229638748629170919761583L ,	/*  53 */
+		 2.685177424507523876687784205642111L ,	/*  54 */
+		 0.880463026400117513445907456528442L ,	/*  55 */
+		 -5.028851220636894000781641860154886L ,	/*  56 */
+		 -0.345528375980267552899564740502809L ,	/*  57 */
+		 1.463210769729252610647950197984332L ,	/*  58 */
+		 3.328421083558773845831213661217473L ,	/*  59 */
+		 -0.237219367348867544302478000953081L ,	/*  60 */
+		 -1.086975102467855285124518662955433L ,	/*  61 */
+		 -1.665522956385441272543654166826322L ,	/*  62 */
+		 1.628826188810637833237799933957786L ,	/*  63 */
+		 0.534088072762271579028480558598819L ,	/*  64 */
+		 -3.050496586573981336729988800871508L ,	/*  65 */
+		 -0.209597199290132551147829173701885L ,	/*  66 */
+		 0.887582325001071924463708308314903L ,	/*  67 */
+		 2.019017208624241617978881916542405L ,	/*  68 */
+		 -0.143897052948667794287398576014199L ,	/*  69 */
+		 -0.659358110687783465436734441488386L ,	/*  70 */
+		 1.470398765538360007057608362195968L ,	/*  71 */
+		 -1.438001204439387236641861379866632L ,	/*  72 */
+		 -0.471517033054129697491462671709087L ,	/*  73 */
+		 2.693115935736958445837210220342131L ,	/*  74 */
+		 0.185041858423466701349131304734898L ,	/*  75 */
+		 -0.783597698243441511703886168766412L ,	/*  76 */
+		 -1.782479430727671821270031859253293L ,	/*  77 */
+		 0.127038806765845112863292192322427L ,	/*  78 */
+		 0.582111071051879583520417701481273L 	/*  79 */
 		}
 
 
 	{
 		count = Count;
+		stride = Stride;
 		indices = startIndices;
 #ifdef WIN
 		_Rotation = std::abs(Rotation);
@@ -642,9 +824,12 @@ public:
 	}
 	~DFT31() { indices.clear(); }
 
-	void Evaluate(Data *real, Data* imag);
+	void Evaluate(Data* real, Data* imag) { Kernel(real, imag, 0, count, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end) { Kernel(real, imag, begin, end, 0); }
+	void Evaluate(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output) { Kernel(real, imag, begin, end, output); }
 
 private:
+	void Kernel(Data* real, Data* imag, s64 begin, s64 end, const StageOutput* output);
 
 	const Data  u[80];
 	const unsigned int  ip[31];
@@ -655,13 +840,119 @@ private:
 };
 
 
-class PrimeFactorDFT
+/*
+*  Cost of one butterfly of each module, counted in the generated code: real
+*  additions (subtractions included) and multiplications, the loads and
+*  stores of real and imag, the Winograd constants used, and the most
+*  values live at any point of the straight line code. Compare the live
+*  values with the 16 (32 with AVX-512) floating point registers of x86-64:
+*  from 7 on the modules spill.
+*/
+struct ModuleCost {
+	uint factor;
+	int additions;
+	int multiplications;
+	int loads;
+	int stores;
+	int constants;
+	int liveValues;
+
+	constexpr int Operations() const { return additions + multiplications; };
+};
+
+constexpr ModuleCost ModuleCosts[] = {
+	/* factor, additions, multiplications, loads, stores, constants, live values */
+	{ 2,    4,   0,  4,  4,  0,   4 },
+	{ 3,   12,   5,  6,  6,  2,   8 },
+	{ 5,   34,  10, 10, 10,  5,  14 },
+	{ 7,   72,  17, 14, 14,  8,  18 },
+	{ 11, 168,  41, 22, 22, 20,  34 },
+	{ 13, 188,  40, 26, 26, 20,  38 },
+	{ 17, 274,  82, 34, 34, 41,  74 },
+	{ 19, 404,  77, 38, 38, 38,  58 },
+	{ 31, 776, 161, 62, 62, 80, 102 },
+};
+
+/*
+*  The cost of the module for factor, all 0 for an unsupported factor.
+*/
+constexpr ModuleCost ModuleCostOf(uint factor, std::size_t i = 0)
+{
+	return (i == sizeof(ModuleCosts) / sizeof(ModuleCosts[0])) ? ModuleCost{ factor, 0, 0, 0, 0, 0, 0 }
+		: (ModuleCosts[i].factor == factor) ? ModuleCosts[i] : ModuleCostOf(factor, i + 1);
+}
+
+/*
+*  The plan machinery common to the transforms: the factors, the length, the
+*  rotations of each factor and the start indices of each stage.
+*/
+class PrimeFactorPlan
+{
+public:
+
+	PrimeFactorPlan() { state = 0; };
+	~PrimeFactorPlan() { Rotations.clear(); };
+
+	void GetFactors(factorSeq& _factors) {_factors = factors;};
+
+	s64 CalcFactors(s64 length, factorSeq& _factors, int factorCount = 0);
+	s64 FastCalcFactors(s64 length, factorSeq& _factors);
+	/*
+	*  Based of the factors provided.
+	*  if > 0 the length of the FFT.
+	*  if == 0 no factors provided.
+	*  if == -1 invalid/unsupported factors provided.
+	*  if == -2 duplicated factor  provided.
+	*/
+	s64 Status() { return state; };
+
+	/*
+	*  Real additions and multiplications of one transform with the factors
+	*  provided, 0 without valid factors.
+	*/
+	s64 Operations();
+
+protected:
+	s64 FindFactors(s64 length, uint start, uint end, const s64* LengthTable);
+
+	s64 ValidateFactors(factorSeq& _factors);
+	s64 state;
+	void InitRotations();
+	void InitIndices(std::vector<s64>& indices, int fftlength, s64 length, s64 stride = 1);
+	factorSeq factors;
+	std::vector<int>  Rotations;
+};
+
+/*
+*  The butterflies each stage has to run when only part of the input is
+*  nonzero and only part of the output is needed, made by PrimeFactorDFT::Prune.
+*/
+class PrunedStages {
+	friend class PrimeFactorDFT;
+public:
+	PrunedStages() { active = 0; total = 0; };
+
+	/* butterflies run, relative to the full transform */
+	double Work() { return (total > 0) ? (double)active / total : 0.0; };
+
+private:
+	/* per stage the runs of butterflies to evaluate, begin, end pairs */
+	std::vector< std::vector<s64> > runs;
+	s64 active;
+	s64 total;
+};
+
+class ThreadPool;
+
+/* shorter transforms do not use the pool */
+#define POOLLIMIT  (1 << 15)
+
+class PrimeFactorDFT : public PrimeFactorPlan
 {
 public:
 	
-	PrimeFactorDFT() {};
+	PrimeFactorDFT() { stride = 1; batchCount = 1; batchDistance = 0; pool = 0; };
 	~PrimeFactorDFT() { 
-		Rotations.clear();
 		while (DFTs.size()) { delete DFTs.back(); DFTs.pop_back(); }
 	};
 
@@ -675,34 +966,143 @@ public:
 		}
 	};
 
-	void GetFactors(factorSeq& _factors) {_factors = factors;};
+	/*
+	*  Advanced layout: every call does batchCount transforms, transform b on
+	*  the points real[b * batchDistance + i * stride], imag[b * batchDistance + i * stride].
+	*  The columns of a rows x columns row major matrix are stride = columns,
+	*  batchCount = columns, batchDistance = 1. Interleaved complex data is
+	*  real = data, imag = data + 1, stride = 2.
+	*  The stride goes into the index tables of the modules, nothing is copied.
+	*  The transforms are in place, so input and output have the same layout.
+	*  Default is one transform with stride 1. Kept when the factors change.
+	*/
+	void SetLayout(s64 _stride, s64 _batchCount = 1, s64 _batchDistance = 0);
+
+	s64 Stride() { return stride; };
+	s64 BatchCount() { return batchCount; };
+	s64 BatchDistance() { return batchDistance; };
 
-	int CalcFactors(uint length, factorSeq& _factors, int factorCount = 0);
-	int FastCalcFactors(uint length, factorSeq& _factors);
 	/*
-	*  Based of the factors provided.
-	*  if > 0 the length of the FFT.
-	*  if == 0 no factors provided.
-	*  if == -1 invalid/unsupported factors provided.
-	*  if == -2 duplicated factor  provided.
+	*  With a pool, e.g. ThreadPool::Default(), the butterflies of every stage
+	*  of a transform of POOLLIMIT points or more are split in chunks that run
+	*  on the pool, the calling thread taking part. The butterflies of a stage
+	*  touch disjoint points, so the result is the same as without. Pruned
+	*  transforms split their runs the same way. The last stage with a sink
+	*  is split only if the sink can Fork. Shorter transforms and the stage
+	*  API run on the calling thread.
+	*  Default is no pool.
 	*/
-	s64 Status() { return state; };
+	void SetPool(ThreadPool* _pool) { pool = _pool; };
+	ThreadPool* Pool() { return pool; };
+
+	/*
+	*  "fma" if the modules run the FMA3 version on this CPU, otherwise "generic".
+	*/
+	static const char* KernelVariant();
 
 	void forwardFFT(Data* real, Data *imag);
 	void InverseFFT(Data* real, Data *imag);
 	void ScaledInverseFFT(Data* real, Data *imag);
 
-private:
-	int FindFactors(uint length, uint start, uint end, uint* LengthTable);
+	/*
+	*  As above, run as a task on the pool, or on ThreadPool::Default()
+	*  without one, and return at once. The future is ready, and done has
+	*  been called on the worker, when the transform is complete. Tasks
+	*  start in the order submitted and idle workers help the running ones,
+	*  so transforms in flight on different buffers share the workers.
+	*  A transform keeps nothing in the plan, a sink included, so any
+	*  transforms may run on one plan at the same time, but the factors and
+	*  the layout must not change while one is in flight.
+	*  A pool without workers runs the transform before returning.
+	*/
+	std::future<void> forwardFFTAsync(Data* real, Data *imag, std::function<void()> done = std::function<void()>());
+	std::future<void> InverseFFTAsync(Data* real, Data *imag, std::function<void()> done = std::function<void()>());
 
-	s64 ValidateFactors(factorSeq& _factors);
-	s64 state;
+	/*
+	*  As above, and the outputs of the last stage are passed to sink as they
+	*  are computed. With store == false they go to sink only, and real, imag
+	*  are left holding intermediate values. With a batch the sink sees the
+	*  transforms one after the other, each with its batch number.
+	*/
+	void forwardFFT(Data* real, Data *imag, StageSink* sink, bool store = true);
+	void InverseFFT(Data* real, Data *imag, StageSink* sink, bool store = true);
+
+	/*
+	*  Pruned transforms for input that is 0 except at the points inStart, ...,
+	*  inStart + inLength - 1, when only the points outStart, ..., outStart +
+	*  outLength - 1 of the result are needed. The ranges are modulo the length,
+	*  so they may wrap around the end. Stages skip the butterflies whose inputs
+	*  are all 0 and those whose outputs are never read, the points not needed
+	*  are left undefined. The same PrunedStages serves both directions.
+	*  Prune returns the number of butterflies left, or -1 without a valid plan.
+	*/
+	s64 Prune(s64 inStart, s64 inLength, s64 outStart, s64 outLength, PrunedStages& pruned);
+	void forwardFFT(Data* real, Data *imag, const PrunedStages& pruned);
+	void InverseFFT(Data* real, Data *imag, const PrunedStages& pruned);
+
+	/*
+	*  The stages one at a time, for callers that schedule the butterflies
+	*  themselves. Stage s runs the module of GetFactors()[s] on Butterflies(s)
+	*  butterflies, butterfly j holding the points j + m * Butterflies(s).
+	*  A transform is all butterflies of stage 0, then of stage 1, ...
+	*  These ignore the batch.
+	*/
+	std::size_t Stages() { return DFTs.size(); };
+	s64 Butterflies(std::size_t stage) { return DFTs[stage]->Butterflies(); };
+	void forwardStage(std::size_t stage, Data* real, Data *imag, s64 begin, s64 end) { DFTs[stage]->Evaluate(real, imag, begin, end); };
+	void InverseStage(std::size_t stage, Data* real, Data *imag, s64 begin, s64 end) { DFTs[stage]->Evaluate(imag, real, begin, end); };
+
+private:
+	void Run(Data* real, Data *imag, bool inverse, StageSink* sink = 0, bool store = true);
+	std::future<void> Async(Data* real, Data *imag, bool inverse, std::function<void()> done);
+	void Stage(std::size_t stage, Data* real, Data *imag, s64 begin, s64 end, const StageOutput* output = 0);
 	void InitDFT(factorSeq& _factors, std::vector<BasicDFT*> &_DTFs);
 	void CleanUpDFT(std::vector<BasicDFT*> &_DTFs);
-	void InitRotations();
-	void InitIndices(std::vector<s64>& indices, int fftlength, s64 length);
-	factorSeq factors;
-	std::vector<int>  Rotations;
 	std::vector<BasicDFT*> DFTs;
+	s64 stride;
+	s64 batchCount;
+	s64 batchDistance;
+	ThreadPool* pool;
 };
 
+/*
+*  Transform data, allocated aligned to DATAALIGN bytes and filled with 0.
+*  Converts to Data*, so it goes wherever the transforms take Data*.
+*  HUGEPAGES aligns to 2 MB and asks the kernel for transparent huge pages.
+*  FIRSTTOUCH writes the 0s from threads threads (0: one per CPU the caller
+*  may run on), thread i the i-th of threads equal blocks, on CPUs spread
+*  over those the caller may run on. Linux puts a page on the NUMA node of
+*  the CPU that first writes it, so the pages are spread over the nodes and
+*  the memory bandwidth of all of them is used. It does not make the
+*  accesses node local: a butterfly reads points from all of the array.
+*  Without it all pages land on the node of the calling thread. Huge pages
+*  and the thread placement are Linux only.
+*/
+#define DATAALIGN 64
+
+class DataBuffer {
+public:
+	enum { HUGEPAGES = 1, FIRSTTOUCH = 2 };
+
+	DataBuffer() { buffer = 0; count = 0; };
+	DataBuffer(s64 _count, int flags = 0, int threads = 0) { buffer = 0; count = 0; Allocate(_count, flags, threads); };
+	~DataBuffer() { Release(); };
+
+	DataBuffer(const DataBuffer&) = delete;
+	DataBuffer& operator=(const DataBuffer&) = delete;
+
+	/*
+	*  Replaces the buffer with _count points. Returns false, and holds
+	*  nothing, if the memory could not be had.
+	*/
+	bool Allocate(s64 _count, int flags = 0, int threads = 0);
+	void Release();
+
+	Data* data() { return buffer; };
+	s64 size() { return count; };
+	operator Data*() { return buffer; };
+
+private:
+	Data* buffer;
+	s64 count;
+};
@@ -11,11 +11,41 @@ If this is what you want to do, use the GNU Library General Public License inste
 
 #include "PrimeFactorDFT.h"
 
+#include "BigMultiply.h"
+#include "MultiDimDFT.h"
+#include "OutOfCoreDFT.h"
+#include "PartialDFT.h"
 #include "PrimeFactorDFT.h"
+#include "PrimeFactorNTT.h"
+#include "SequenceMatcher.h"
+#include "SharedMemoryDFT.h"
+#include "SlidingDFT.h"
+#include "SlowFFT.h"
+#include "STFT.h"
+#include "StageProfiler.h"
+#include "StreamFilter.h"
+#include "ThreadPool.h"
+#include "TransformPipeline.h"
+#include "TrigTransform.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#ifdef NOTWIN
+#include <signal.h>
+#endif
 #define LIMIT 1000000
 #define WCOUNT 100
 
+static std::mt19937_64 mt;
+
 
 void ClearData(s64 Length, Data* dreal, Data* dimag)
 {
@@ -45,9 +75,9 @@ void test1()
 
     if (pf.Status() > 0) {
 
-        Data* real = new Data[pf.Status()];
-        Data* imag = new Data[pf.Status()];
-        for (int i = 0; i < pf.Status(); i++)
+        DataBuffer real(pf.Status());
+        DataBuffer imag(pf.Status());
+        for (s64 i = 0; i < pf.Status(); i++)
         {
             if (i % 4 == 1) real[i] = 1.0;
             else if (i % 2 == 0) real[i] = 0.0;
@@ -56,15 +86,12 @@ void test1()
         }
 
         pf.forwardFFT(real, imag);
-        for (int i = 0; i < pf.Status(); i++)
+        for (s64 i = 0; i < pf.Status(); i++)
             std::cout << i << " : " << real[i] << "  " << imag[i] << std::endl;
 
         pf.InverseFFT(real, imag);
-        for (int i = 0; i < pf.Status(); i++)
+        for (s64 i = 0; i < pf.Status(); i++)
             std::cout << i << " " << real[i] << "  " << imag[i] << std::endl;
-
-        delete[] real;
-        delete[] imag;
     }
     std::cout << "Test1 end " << std::endl << std::endl;
 
@@ -98,12 +125,12 @@ void InitDNA(s64 Length, Data *DNAreal, Data *DNAimag)
 
 #define PERMCOUNT 10
 
-    static std::uniform_int_distribution<uint>* dist;
-    dist = new std::uniform_int_distribution<uint>(0, (4 * ((int)len)) - 1);
-    for (uint x = 0; x < PERMCOUNT; x++)
-       for (uint ix = 0; ix < 4 * len; ix++)
+    static std::uniform_int_distribution<s64>* dist;
+    dist = new std::uniform_int_distribution<s64>(0, (4 * len) - 1);
+    for (int x = 0; x < PERMCOUNT; x++)
+       for (s64 ix = 0; ix < 4 * len; ix++)
        {
-           uint i1 = 0;
+           s64 i1 = 0;
            i1 = dist->operator()(mt);
            Data t = DNAreal[ix];
            DNAreal[ix] = DNAreal[i1];
@@ -114,7 +141,7 @@ void InitDNA(s64 Length, Data *DNAreal, Data *DNAimag)
 
 }
 
-uint InitSubDNA(s64 substringLength, s64 Length, Data* subDNAreal, Data* subDNAimag, Data *DNAreal)
+s64 InitSubDNA(s64 substringLength, s64 Length, Data* subDNAreal, Data* subDNAimag, Data *DNAreal)
 {
 
     for (s64 i = 0; i < Length; i++) {
@@ -122,17 +149,17 @@ uint InitSubDNA(s64 substringLength, s64 Length, Data* subDNAreal, Data* subDNAi
         subDNAimag[i] = 0;
     }
 
-    static std::uniform_int_distribution<uint>* dist;
+    static std::uniform_int_distribution<s64>* dist;
 
-    dist = new std::uniform_int_distribution<uint>(0, (4 * ((int) (Length/8))) - 1);
-    uint i1 = 0;
+    dist = new std::uniform_int_distribution<s64>(0, (4 * (Length / 8)) - 1);
+    s64 i1 = 0;
     do {
         i1 = dist->operator()(mt);
-    } while (i1 >= ((4 * ((int)(Length / 8))) - substringLength));
+    } while (i1 >= ((4 * (Length / 8)) - substringLength));
     std::cout << "start:  " << i1 << std::endl;
     /* we swap direction ! */
     s64 iy = Length - 1;
-    for (uint ix = 0; ix < substringLength; ix++)
+    for (s64 ix = 0; ix < substringLength; ix++)
         subDNAreal[iy--] = DNAreal[ix + i1];
 
     return i1;
@@ -177,49 +204,42 @@ void test2DNA()
 
     if (pf.Status() > 0) {
 
-        Data* DNAreal    = new Data[pf.Status()];
-        Data* DNAimag    = new Data[pf.Status()];
-        Data* subDNAreal = new Data[pf.Status()];
-        Data* subDNAimag = new Data[pf.Status()];
-        Data* Matchreal  = new Data[pf.Status()];
-        Data* Matchimag  = new Data[pf.Status()];
+        /* the pages are spread over the NUMA nodes */
+        int layout = DataBuffer::FIRSTTOUCH | DataBuffer::HUGEPAGES;
+        DataBuffer DNAreal    (pf.Status(), layout);
+        DataBuffer DNAimag    (pf.Status(), layout);
+        DataBuffer subDNAreal (pf.Status(), layout);
+        DataBuffer subDNAimag (pf.Status(), layout);
+        DataBuffer Matchreal  (pf.Status(), layout);
+        DataBuffer Matchimag  (pf.Status(), layout);
 
         InitDNA(pf.Status(),DNAreal, DNAimag);
         InitSubDNA(SUBSTRINGLENGTH, pf.Status(), subDNAreal, subDNAimag, DNAreal );
 
 
-        pf.forwardFFT(DNAreal, DNAimag);
-        pf.forwardFFT(subDNAreal, subDNAimag);
+        /* only the first half of DNA and the last SUBSTRINGLENGTH points of subDNA are nonzero */
+        PrunedStages DNApruning, subDNApruning;
+        pf.Prune(0, 4 * (pf.Status() / 8), 0, pf.Status(), DNApruning);
+        pf.Prune(pf.Status() - SUBSTRINGLENGTH, SUBSTRINGLENGTH, 0, pf.Status(), subDNApruning);
+        std::cout << "pruned work DNA " << DNApruning.Work() << " subDNA " << subDNApruning.Work() << std::endl;
+
+        pf.forwardFFT(DNAreal, DNAimag, DNApruning);
+        pf.forwardFFT(subDNAreal, subDNAimag, subDNApruning);
 
         Multiply(pf.Status(), Matchreal, Matchimag, DNAreal, DNAimag, subDNAreal, subDNAimag);
-        pf.ScaledInverseFFT(Matchreal, Matchimag);
-
-        Data max = 0;
-        Data max2 = 0;
-        s64 maxIndex = 0;
-        s64 maxIndex2 = 0;
-        for (int i = 0; i < pf.Status(); i++) {
-            Data val = (Matchreal[i] * Matchreal[i]) + (Matchimag[i] * Matchimag[i]);
-            //std::cout << i << " : " << val << std::endl;
-            if (val > max) {
-                max2 = max;
-                max = val;
-                maxIndex2 = maxIndex;
-                maxIndex = i;
-            }
-        }
-        std::cout << " maxIndex  : " << maxIndex   << " val : " << max  << std::endl;
-        std::cout << " maxIndex2 : " << maxIndex2  << " val : " << max2 << std::endl;
+        /* the two best matches are picked from the last stage, the result is not stored */
+        TopKPeaks peaks(2);
+        pf.InverseFFT(Matchreal, Matchimag, &peaks, false);
+
+        std::vector<Peak> best;
+        peaks.Result(best);
+        Data scale = (Data)pf.Status() * pf.Status();
+        if (best.size() > 0) std::cout << " maxIndex  : " << best[0].index << " val : " << best[0].value / scale << std::endl;
+        if (best.size() > 1) std::cout << " maxIndex2 : " << best[1].index << " val : " << best[1].value / scale << std::endl;
         //pf.InverseFFT(real, imag);
-        //for (int i = 0; i < pf.Status(); i++)
+        //for (s64 i = 0; i < pf.Status(); i++)
         //    std::cout << i << " " << real[i] << "  " << imag[i] << std::endl;
 
-        delete[] DNAreal;
-        delete[] DNAimag;
-        delete[] subDNAreal;
-        delete[] subDNAimag;
-        delete[] Matchreal;
-        delete[] Matchimag;
 
     }
     std::cout << "Test2DNA End " << std::endl << std::endl;
@@ -248,12 +268,12 @@ void test3Convolution()
 
     if (pf.Status() > 0) {
 
-        Data* A1real = new Data[pf.Status()];
-        Data* A1imag = new Data[pf.Status()];
-        Data* A2real = new Data[pf.Status()];
-        Data* A2imag = new Data[pf.Status()];
-        Data* Resreal = new Data[pf.Status()];
-        Data* Resimag = new Data[pf.Status()];
+        DataBuffer A1real(pf.Status());
+        DataBuffer A1imag(pf.Status());
+        DataBuffer A2real(pf.Status());
+        DataBuffer A2imag(pf.Status());
+        DataBuffer Resreal(pf.Status());
+        DataBuffer Resimag(pf.Status());
 
         ClearData(pf.Status(), A1real, A1imag);
         ClearData(pf.Status(), A2real, A2imag);
@@ -277,15 +297,9 @@ void test3Convolution()
         pf.ScaledInverseFFT(Resreal, Resimag);
 
         //pf.InverseFFT(Resreal, Resimag);
-        for (int i = 0; i < pf.Status(); i++)
+        for (s64 i = 0; i < pf.Status(); i++)
             std::cout << i << " " << Resreal[i] << "  " << Resimag[i] << std::endl;
 
-        delete[] A1real ;
-        delete[] A1imag ;
-        delete[] A2real ;
-        delete[] A2imag ;
-        delete[] Resreal;
-        delete[] Resimag;
 
     }
     std::cout << "Test3Convolution End " << std::endl << std::endl;
@@ -293,6 +307,100 @@ void test3Convolution()
 }
 
 
+/*
+    The largest and the rms error, both relative to the largest reference
+    value, so the rms is never over the largest.
+*/
+void Errors(s64 Length, const Data* real, const Data* imag, const Data* refReal, const Data* refImag, Data& maxError, Data& rmsError)
+{
+    Data maxDiff = 0, maxRef = 0, sumDiff = 0;
+    for (s64 i = 0; i < Length; i++) {
+        Data dr = real[i] - refReal[i];
+        Data di = imag[i] - refImag[i];
+        Data diff = dr * dr + di * di;
+        Data ref = refReal[i] * refReal[i] + refImag[i] * refImag[i];
+        if (diff > maxDiff) maxDiff = diff;
+        if (ref > maxRef) maxRef = ref;
+        sumDiff += diff;
+    }
+    Data rmsDiff = sumDiff / Length;
+    maxError = (maxRef > 0) ? std::sqrt(maxDiff / maxRef) : std::sqrt(maxDiff);
+    rmsError = (maxRef > 0) ? std::sqrt(rmsDiff / maxRef) : std::sqrt(rmsDiff);
+}
+
+/*
+    Every one of the 511 sets of factors up to a length of limit, against
+    SlowFFT: forward, inverse and forward followed by ScaledInverseFFT.
+    An error over ERRORBUDGET * epsilon * log2(N) fails.
+    Returns the number of failures.
+*/
+#define ERRORBUDGET 8
+
+int testAccuracy(s64 limit)
+{
+    static const uint primes[] = { 2, 3, 5, 7, 11, 13, 17, 19, 31 };
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    int tested = 0, skipped = 0, failed = 0;
+    Data worst = 0;
+
+    std::cout << "TestAccuracy begin " << std::endl;
+    std::cout << "N : forward max rms : inverse max rms : round trip max rms" << std::endl;
+
+    for (int set = 1; set < (1 << 9); set++)
+    {
+        factorSeq factors;
+        s64 N = 1;
+        for (int b = 0; b < 9; b++)
+            if (set & (1 << b)) { factors.push_back(primes[b]); N *= primes[b]; }
+        if (N > limit) { skipped++; continue; }
+
+        PrimeFactorDFT pf;
+        SlowFFT sft;
+        pf.SetFactors(factors);
+        sft.SetFactors(factors);
+
+        DataBuffer real(N), imag(N), sreal(N), simag(N);
+        Data errors[6];
+
+        for (int direction = 0; direction < 2; direction++) {
+            for (s64 i = 0; i < N; i++) {
+                sreal[i] = real[i] = dist(mt);
+                simag[i] = imag[i] = dist(mt);
+            }
+            if (direction == 0) { pf.forwardFFT(real, imag); sft.forwardFFT(sreal, simag); }
+            else { pf.InverseFFT(real, imag); sft.InverseFFT(sreal, simag); }
+            Errors(N, real, imag, sreal, simag, errors[2 * direction], errors[2 * direction + 1]);
+        }
+
+        for (s64 i = 0; i < N; i++) {
+            sreal[i] = real[i] = dist(mt);
+            simag[i] = imag[i] = dist(mt);
+        }
+        pf.forwardFFT(real, imag);
+        pf.ScaledInverseFFT(real, imag);
+        Errors(N, real, imag, sreal, simag, errors[4], errors[5]);
+
+        Data budget = ERRORBUDGET * std::numeric_limits<Data>::epsilon() * std::log2((Data)N);
+        bool ok = true;
+        std::cout << N;
+        for (int e = 0; e < 6; e++) {
+            std::cout << ((e % 2 == 0) ? " : " : " ") << errors[e];
+            if (!(errors[e] <= budget)) ok = false;
+            if (errors[e] > worst) worst = errors[e];
+        }
+        std::cout << (ok ? "" : "  FAILED") << std::endl;
+
+        tested++;
+        if (!ok) failed++;
+    }
+
+    std::cout << "tested " << tested << " skipped " << skipped << " (longer than " << limit << ")"
+        << " failed " << failed << " worst " << worst << std::endl;
+    std::cout << "TestAccuracy end " << std::endl << std::endl;
+    return failed;
+}
+
+
 void test4()
 {
     PrimeFactorDFT pf;
@@ -316,11 +424,11 @@ void test4()
 
     if (pf.Status() > 0) {
 
-        Data* real = new Data[pf.Status()];
-        Data* imag = new Data[pf.Status()];
-        Data* sreal = new Data[pf.Status()];
-        Data* simag = new Data[pf.Status()];
-        for (int i = 0; i < pf.Status(); i++)
+        DataBuffer real(pf.Status());
+        DataBuffer imag(pf.Status());
+        DataBuffer sreal(pf.Status());
+        DataBuffer simag(pf.Status());
+        for (s64 i = 0; i < pf.Status(); i++)
         {
             if (i % 4 == 1) sreal[i] = real[i] = 1.0;
             else if (i % 2 == 0) sreal[i] = real[i] = 0.0;
@@ -335,29 +443,1612 @@ void test4()
         sft.forwardFFT(sreal, simag);
         std::cout << "SFT end" << std::endl;
 
-        for (int i = 0; i < pf.Status(); i++) {
-            std::cout << "PFA :" << i << " : " << real[i] << "  " << imag[i] << std::endl;
-            std::cout << "Ref :" << i << " : " << sreal[i] << "  " << simag[i] << std::endl << std::endl;
+        Data maxError = 0, rmsError = 0;
+        Errors(pf.Status(), real, imag, sreal, simag, maxError, rmsError);
+        std::cout << "max error " << maxError << " rms error " << rmsError << std::endl;
+    }
+    std::cout << "Test4 end " << std::endl << std::endl;
+
+}
+
+
+/*
+    Counts the outputs it is given, the forks add theirs in on Join.
+*/
+class CountingSink : public StageSink {
+public:
+    CountingSink(s64 _N) : seen(_N, 0) { joins = 0; };
+    void Consume(const s64* index, const Data* real, const Data* imag, int length, s64 batch)
+    {
+        (void)real; (void)imag; (void)batch;
+        for (int i = 0; i < length; i++) seen[index[i]]++;
+    };
+    StageSink* Fork() { return new CountingSink((s64)seen.size()); };
+    void Join(StageSink* part)
+    {
+        CountingSink* other = (CountingSink*)part;
+        for (std::size_t i = 0; i < seen.size(); i++) seen[i] += other->seen[i];
+        joins++;
+    };
+
+    std::vector<int> seen;
+    int joins;
+};
+
+/*
+    The peaks found by a sink on a strided batch are the points of the
+    transforms, with the batch they are from: three interleaved transforms
+    (stride 2) side by side, against the largest powers of the contiguous
+    transform of each. Then a transform over POOLLIMIT on a pool of three
+    workers, forward and inverse: the peaks of the chunks merged must be
+    those of the same transform without a pool, and a sink that counts sees
+    every output once over its forks. Returns the number of failures.
+*/
+int test5Peaks()
+{
+    PrimeFactorDFT pf, ref;
+    factorSeq factors = { 3, 5, 7 };
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    int failed = 0;
+
+    std::cout << "Test5Peaks begin " << std::endl;
+    pf.SetFactors(factors);
+    ref.SetFactors(factors);
+    s64 N = pf.Status();
+    const s64 batches = 3;
+    pf.SetLayout(2, batches, 2 * N);
+
+    DataBuffer data(2 * N * batches);
+    for (s64 i = 0; i < 2 * N * batches; i++) data[i] = dist(mt);
+
+    std::vector<Peak> expected;
+    DataBuffer real(N), imag(N);
+    for (s64 b = 0; b < batches; b++) {
+        for (s64 i = 0; i < N; i++) {
+            real[i] = data[b * 2 * N + 2 * i];
+            imag[i] = data[b * 2 * N + 2 * i + 1];
         }
-        //pf.InverseFFT(real, imag);
-        //for (int i = 0; i < pf.Status(); i++)
-        //    std::cout << i << " " << real[i] << "  " << imag[i] << std::endl;
+        ref.forwardFFT(real, imag);
+        for (s64 i = 0; i < N; i++) {
+            Peak p = { i, real[i] * real[i] + imag[i] * imag[i], b };
+            expected.push_back(p);
+        }
+    }
+    std::sort(expected.begin(), expected.end(), [](const Peak& a, const Peak& b) { return a.value > b.value; });
+
+    TopKPeaks peaks(4);
+    pf.forwardFFT(data, data + 1, &peaks, false);
+    std::vector<Peak> best;
+    peaks.Result(best);
+
+    for (std::size_t k = 0; k < 4; k++) {
+        bool ok = k < best.size() && best[k].index == expected[k].index && best[k].batch == expected[k].batch
+            && std::fabs(best[k].value - expected[k].value) <= 1e-9 * expected[k].value;
+        std::cout << "peak " << k << " index " << expected[k].index << " batch " << expected[k].batch << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
 
-        delete[] real;
-        delete[] imag;
-        delete[] sreal;
-        delete[] simag;
+    factorSeq large = { 2, 3, 5, 7, 11, 17 };
+    ThreadPool pool(3);
+    PrimeFactorDFT pooled, serial;
+    pooled.SetFactors(large);
+    pooled.SetPool(&pool);
+    serial.SetFactors(large);
+    s64 L = serial.Status();
+    DataBuffer input(2 * L), a(2 * L), b(2 * L);
+    for (s64 i = 0; i < 2 * L; i++) input[i] = dist(mt);
+    for (int inverse = 0; inverse < 2; inverse++)
+    {
+        TopKPeaks pooledPeaks(16), serialPeaks(16);
+        CountingSink counts(L);
+        for (s64 i = 0; i < 2 * L; i++) a[i] = b[i] = input[i];
+        if (inverse) {
+            pooled.InverseFFT(a, a + L, &pooledPeaks);
+            serial.InverseFFT(b, b + L, &serialPeaks);
+            pooled.InverseFFT(input, input + L, &counts, false);
+        }
+        else {
+            pooled.forwardFFT(a, a + L, &pooledPeaks);
+            serial.forwardFFT(b, b + L, &serialPeaks);
+            pooled.forwardFFT(input, input + L, &counts, false);
+        }
+        std::vector<Peak> fromPool, fromSerial;
+        pooledPeaks.Result(fromPool);
+        serialPeaks.Result(fromSerial);
+
+        bool ok = fromPool.size() == 16 && fromSerial.size() == 16 && counts.joins > 1;
+        for (std::size_t k = 0; ok && k < fromPool.size(); k++)
+            if (fromPool[k].index != fromSerial[k].index || fromPool[k].value != fromSerial[k].value) ok = false;
+        for (s64 i = 0; i < 2 * L; i++)
+            if (a[i] != b[i]) ok = false;
+        for (s64 i = 0; i < L; i++)
+            if (counts.seen[i] != 1) ok = false;
+        std::cout << "N " << L << (inverse ? " inverse" : " forward") << " on the pool, " << counts.joins << " chunks"
+            << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
     }
-    std::cout << "Test4 end " << std::endl << std::endl;
+    std::cout << "Test5Peaks end " << std::endl << std::endl;
+    return failed;
+}
+
+/*
+    PrimeFactorNTT against the O(N^2) transform modulo each of three primes,
+    and the round trip. The root the transform uses is read off the transform
+    of a unit impulse at 1, X[k] = W^k, and must have order N.
+    Returns the number of failures.
+*/
+int test6NTT()
+{
+    static const uint sets[][4] = { { 2, 3, 5, 7 }, { 3, 11, 13, 0 }, { 5, 17, 0, 0 }, { 2, 19, 31, 0 }, { 7, 11, 13, 0 } };
+    int failed = 0;
+
+    std::cout << "Test6NTT begin " << std::endl;
+    for (std::size_t set = 0; set < sizeof(sets) / sizeof(sets[0]); set++)
+    {
+        factorSeq factors;
+        for (int j = 0; j < 4 && sets[set][j] != 0; j++) factors.push_back(sets[set][j]);
+
+        PrimeFactorNTT ntt;
+        ntt.SetFactors(factors, 3);
+        s64 N = ntt.Status();
+
+        for (int prime = 0; prime < ntt.PrimeCount(); prime++)
+        {
+            u64 q = ntt.Prime(prime);
+            std::uniform_int_distribution<u64> dist(0, q - 1);
+            std::vector<u64> x(N), X(N), impulse(N, 0);
+
+            impulse[1] = 1;
+            ntt.forwardNTT(impulse.data(), prime);
+            u64 W = impulse[1];
+            bool ok = PowMod(W, N, q) == 1;
+            for (std::size_t f = 0; f < factors.size(); f++)
+                if (PowMod(W, N / factors[f], q) == 1) ok = false;
+
+            for (s64 i = 0; i < N; i++) X[i] = x[i] = dist(mt);
+            ntt.forwardNTT(X.data(), prime);
+
+            /* X[k] = sum x[n] * W^(n * k) */
+            for (s64 k = 0; k < N && ok; k++) {
+                u64 Wk = PowMod(W, k, q), Wnk = 1, sum = 0;
+                for (s64 n = 0; n < N; n++) {
+                    sum = AddMod(sum, MulMod(x[n], Wnk, q), q);
+                    Wnk = MulMod(Wnk, Wk, q);
+                }
+                if (sum != X[k]) ok = false;
+            }
 
+            ntt.InverseNTT(X.data(), prime);
+            for (s64 i = 0; i < N && ok; i++)
+                if (X[i] != x[i]) ok = false;
+
+            std::cout << "N " << N << " q " << q << (ok ? " ok" : "  FAILED") << std::endl;
+            if (!ok) failed++;
+        }
+    }
+    std::cout << "Test6NTT end " << std::endl << std::endl;
+    return failed;
 }
 
+/* the product limb by limb, the reference for BigMultiply */
+static void SchoolbookProduct(const std::vector<uint>& a, const std::vector<uint>& b, std::vector<uint>& result)
+{
+    result.assign(a.size() + b.size(), 0);
+    for (std::size_t i = 0; i < a.size(); i++) {
+        u64 carry = 0;
+        for (std::size_t j = 0; j < b.size(); j++) {
+            u64 t = (u64)a[i] * b[j] + result[i + j] + carry;
+            result[i + j] = (uint)t;
+            carry = t >> 32;
+        }
+        result[i + b.size()] = (uint)carry;
+    }
+}
 
-int main()
+/* 10^digits - 1 in 32 bit limbs */
+static std::vector<uint> Nines(int digits)
+{
+    std::vector<uint> n(1, 1);
+    for (int d = 0; d < digits; d++) {
+        u64 carry = 0;
+        for (std::size_t l = 0; l < n.size(); l++) {
+            u64 t = (u64)n[l] * 10 + carry;
+            n[l] = (uint)t;
+            carry = t >> 32;
+        }
+        if (carry) n.push_back((uint)carry);
+    }
+    /* 10^digits may end in 0 limbs, the borrow runs through them */
+    std::size_t l = 0;
+    while (n[l] == 0) n[l++] = 0xFFFFFFFF;
+    n[l]--;
+    if (n.back() == 0) n.pop_back();
+    return n;
+}
+
+/*
+    BigMultiply against the schoolbook product: random operands of several
+    sizes, all limbs 0xFFFFFFFF, and numbers of decimal 9s, where every
+    coefficient of the convolution is near its largest and carries run
+    through the whole result. Multiply and Square, whose rounding errors must
+    be reported at most MAXROUNDING. Returns the number of failures.
+*/
+int test7BigMultiply()
+{
+    static const int sizes[][2] = { { 40, 40 }, { 100, 57 }, { 1000, 1000 }, { 3000, 170 }, { 5000, 4999 } };
+    std::uniform_int_distribution<uint> dist;
+    BigMultiply bm;
+    int failed = 0;
+
+    std::cout << "Test7BigMultiply begin " << std::endl;
+    for (int kind = 0; kind < 3; kind++)
+        for (std::size_t t = 0; t < sizeof(sizes) / sizeof(sizes[0]); t++)
+        {
+            std::vector<uint> a, b, product, expected, square, expectedSquare;
+            if (kind == 2) {
+                /* 9.63 digits per limb */
+                a = Nines((int)(sizes[t][0] * 9.63));
+                b = Nines((int)(sizes[t][1] * 9.63));
+            }
+            else {
+                a.resize(sizes[t][0]);
+                b.resize(sizes[t][1]);
+                for (std::size_t i = 0; i < a.size(); i++) a[i] = kind ? 0xFFFFFFFF : dist(mt);
+                for (std::size_t i = 0; i < b.size(); i++) b[i] = kind ? 0xFFFFFFFF : dist(mt);
+            }
+
+            SchoolbookProduct(a, b, expected);
+            bool ok = bm.Multiply(a, b, product) == (s64)expected.size() && product == expected;
+            Data error = bm.MaxError();
+
+            SchoolbookProduct(a, a, expectedSquare);
+            ok = ok && bm.Square(a, square) == (s64)expectedSquare.size() && square == expectedSquare;
+            Data squareError = bm.MaxError();
+            ok = ok && error <= MAXROUNDING && squareError <= MAXROUNDING;
+
+            std::cout << ((kind == 0) ? "random " : (kind == 1) ? "ones   " : "nines  ") << a.size() << " x " << b.size()
+                << " limbs  max error " << error << " square " << squareError << (ok ? "" : "  FAILED") << std::endl;
+            if (!ok) failed++;
+        }
+    std::cout << "Test7BigMultiply end " << std::endl << std::endl;
+    return failed;
+}
+
+/*
+    StreamFilter against the direct convolution y[t] = sum kernel[j] * x[t - j]:
+    the input goes in pieces of random sizes, output t must be y[t - Latency()],
+    the first Latency() = 2L outputs 0. Returns the number of failures.
+*/
+int test8StreamFilter()
 {
+    static const s64 filters[][2] = { { 1, 0 }, { 33, 0 }, { 100, 1000 }, { 257, 0 } };
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    int failed = 0;
+
+    std::cout << "Test8StreamFilter begin " << std::endl;
+    for (std::size_t f = 0; f < sizeof(filters) / sizeof(filters[0]); f++)
+    {
+        s64 taps = filters[f][0];
+        std::vector<Data> kernel(taps);
+        for (s64 j = 0; j < taps; j++) kernel[j] = dist(mt);
+
+        StreamFilter filter;
+        s64 N = filter.SetKernel(kernel.data(), taps, filters[f][1]);
+        s64 latency = filter.Latency();
+        s64 samples = 5 * latency + 123;
+
+        std::vector<Data> in(samples), out(samples);
+        for (s64 t = 0; t < samples; t++) in[t] = dist(mt);
+        std::uniform_int_distribution<s64> piece(1, latency);
+        for (s64 t = 0; t < samples; ) {
+            s64 n = piece(mt);
+            if (n > samples - t) n = samples - t;
+            filter.Push(in.data() + t, n, out.data() + t);
+            t += n;
+        }
+
+        Data maxError = 0;
+        for (s64 t = 0; t < samples; t++) {
+            Data y = 0;
+            for (s64 j = 0; j < taps && j <= t - latency; j++) y += kernel[j] * in[t - latency - j];
+            Data e = std::fabs(out[t] - y);
+            if (e > maxError) maxError = e;
+        }
+
+        /* two blocks of L = N - taps + 1 */
+        bool ok = N > 0 && latency == 2 * (N - taps + 1) && maxError < 1e-12 * taps;
+        std::cout << "taps " << taps << " N " << N << " latency " << latency << " max error " << maxError << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
+    std::cout << "Test8StreamFilter end " << std::endl << std::endl;
+    return failed;
+}
+
+/*
+    SequenceMatcher with probes planted in a random reference: the best match
+    of every probe must be where it was planted, with a score of 1. Three
+    probes, so one transform carries a single probe. Returns the number of failures.
+*/
+int test9SequenceMatcher()
+{
+    static const char bases[] = "ATGC";
+    static const s64 planted[][2] = { { 1234, 50 }, { 17, 120 }, { 19000, 300 } };
+    std::uniform_int_distribution<int> dist(0, 3);
+    int failed = 0;
+
+    std::cout << "Test9SequenceMatcher begin " << std::endl;
+    std::string reference(20000, 'A');
+    for (std::size_t i = 0; i < reference.size(); i++) reference[i] = bases[dist(mt)];
+
+    std::vector<std::string> probes;
+    for (std::size_t p = 0; p < sizeof(planted) / sizeof(planted[0]); p++) {
+        std::string probe(planted[p][1], 'A');
+        for (std::size_t i = 0; i < probe.size(); i++) probe[i] = bases[dist(mt)];
+        reference.replace(planted[p][0], probe.size(), probe);
+        probes.push_back(probe);
+    }
+
+    SequenceMatcher matcher;
+    s64 N = matcher.SetReference(reference, 300);
+    std::vector< std::vector<SequenceMatch> > matches;
+    matcher.Match(probes, 2, matches);
+
+    for (std::size_t p = 0; p < probes.size(); p++) {
+        bool ok = N > 0 && matches[p].size() == 2 && matches[p][0].position == planted[p][0]
+            && std::fabs(matches[p][0].score - 1.0) < 1e-9 && matches[p][1].score < 1.0 - 1e-9;
+        std::cout << "probe " << p << " planted at " << planted[p][0];
+        if (matches[p].size()) std::cout << " found at " << matches[p][0].position << " score " << matches[p][0].score;
+        std::cout << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
+    std::cout << "Test9SequenceMatcher end " << std::endl << std::endl;
+    return failed;
+}
+
+/*
+    SetLayout against the contiguous transform of each gathered sequence:
+    interleaved complex data, the columns of a row major matrix and a batch of
+    rows with gaps between them, forward, inverse and scaled inverse. The
+    points outside the layout must be left alone. Returns the number of failures.
+*/
+int test10Layout()
+{
+    /* stride, batch count, batch distance, with real and imag the same array at offsets 0 and 1 */
+    static const s64 layouts[][4] = { { 2, 1, 0, 1 }, { 11, 11, 1, 0 }, { 1, 4, 112, 0 }, { 3, 5, 320, 0 } };
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    factorSeq factors = { 3, 5, 7 };
+    PrimeFactorDFT ref;
+    ref.SetFactors(factors);
+    s64 N = ref.Status();
+    int failed = 0;
+
+    std::cout << "Test10Layout begin " << std::endl;
+    for (std::size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++)
+    {
+        s64 stride = layouts[l][0], batches = layouts[l][1], distance = layouts[l][2];
+        bool interleaved = layouts[l][3] != 0;
+        /* the layout may come before or after the factors */
+        PrimeFactorDFT pf;
+        if (l % 2) pf.SetFactors(factors);
+        pf.SetLayout(stride, batches, distance);
+        pf.SetFactors(factors);
+
+        s64 size = (batches - 1) * distance + (N - 1) * stride + 2;
+        DataBuffer a(size), b(size), before(size);
+        Data* real = a;
+        Data* imag = interleaved ? a + 1 : (Data*)b;
+
+        bool ok = pf.Status() == N && pf.Stride() == stride && pf.BatchCount() == batches;
+        for (int direction = 0; direction < 3; direction++)
+        {
+            for (s64 i = 0; i < size; i++) { a[i] = dist(mt); b[i] = dist(mt); }
+            DataBuffer expectedReal(N * batches), expectedImag(N * batches);
+            for (s64 t = 0; t < batches; t++) {
+                Data* er = expectedReal + t * N;
+                Data* ei = expectedImag + t * N;
+                for (s64 i = 0; i < N; i++) {
+                    er[i] = real[t * distance + i * stride];
+                    ei[i] = imag[t * distance + i * stride];
+                }
+                if (direction == 0) ref.forwardFFT(er, ei);
+                else if (direction == 1) ref.InverseFFT(er, ei);
+                else ref.ScaledInverseFFT(er, ei);
+            }
+            for (s64 i = 0; i < size; i++) before[i] = interleaved ? a[i] : a[i] + b[i];
+
+            if (direction == 0) pf.forwardFFT(real, imag);
+            else if (direction == 1) pf.InverseFFT(real, imag);
+            else pf.ScaledInverseFFT(real, imag);
+
+            std::vector<bool> inside(size, false);
+            for (s64 t = 0; t < batches; t++)
+                for (s64 i = 0; i < N; i++) {
+                    s64 at = t * distance + i * stride;
+                    inside[at] = true;
+                    if (interleaved) inside[at + 1] = true;
+                    if (real[at] != expectedReal[t * N + i] || imag[at] != expectedImag[t * N + i]) ok = false;
+                }
+            for (s64 i = 0; i < size; i++)
+                if (!inside[i] && before[i] != (interleaved ? a[i] : a[i] + b[i])) ok = false;
+        }
+
+        std::cout << "stride " << stride << " batch " << batches << " distance " << distance
+            << (interleaved ? " interleaved" : "") << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
+    std::cout << "Test10Layout end " << std::endl << std::endl;
+    return failed;
+}
+
+/*
+    PartialDFT against the bins of the full transform, on both sides of the
+    switch to the full transform: with N = 1155 16 bins use the recurrences
+    and 17 the transform. Complex and real input. Returns the number of failures.
+*/
+int test11PartialDFT()
+{
+    static const s64 counts[] = { 1, 16, 17, 40 };
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    factorSeq factors = { 3, 5, 7, 11 };
+    PrimeFactorDFT pf;
+    pf.SetFactors(factors);
+    s64 N = pf.Status();
+    int failed = 0;
+
+    std::cout << "Test11PartialDFT begin " << std::endl;
+    for (std::size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        std::vector<s64> bins(counts[c]);
+        std::uniform_int_distribution<s64> bin(-N, 2 * N);
+        bins[0] = 0;
+        for (s64 b = 1; b < counts[c]; b++) bins[b] = bin(mt);
+
+        PartialDFT partial;
+        bool ok = partial.SetBins(factors, bins) == N && partial.FullTransform() == (counts[c] > 16);
+
+        for (int complex = 0; complex < 2; complex++)
+        {
+            DataBuffer real(N), imag(N), transformReal(N), transformImag(N);
+            for (s64 i = 0; i < N; i++) {
+                transformReal[i] = real[i] = dist(mt);
+                transformImag[i] = imag[i] = complex ? dist(mt) : 0;
+            }
+            pf.forwardFFT(transformReal, transformImag);
+
+            std::vector<Data> binReal(counts[c]), binImag(counts[c]);
+            if (complex) partial.Evaluate(real, imag, binReal.data(), binImag.data());
+            else partial.Evaluate(real, binReal.data(), binImag.data());
+
+            for (s64 b = 0; b < counts[c]; b++) {
+                s64 k = ((bins[b] % N) + N) % N;
+                if (std::fabs(binReal[b] - transformReal[k]) > 1e-11 || std::fabs(binImag[b] - transformImag[k]) > 1e-11) ok = false;
+            }
+        }
+
+        std::cout << counts[c] << " bins " << (partial.FullTransform() ? "full transform" : "recurrences") << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
+    std::cout << "Test11PartialDFT end " << std::endl << std::endl;
+    return failed;
+}
+
+/*
+    STFT against a forwardFFT of every windowed frame: the N / 2 + 1 bins of
+    the power and the magnitude spectrum, for a number of frames that leaves
+    the last batch part empty, on the calling thread and on several.
+    Returns the number of failures.
+*/
+int test12STFT()
+{
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    factorSeq factors = { 3, 5, 7, 11 };
+    PrimeFactorDFT pf;
+    pf.SetFactors(factors);
+    s64 N = pf.Status();
+    const s64 hop = 300;
+    const s64 samples = 60 * hop + N + 17;
+    int failed = 0;
+
+    std::cout << "Test12STFT begin " << std::endl;
+    std::vector<Data> signal(samples);
+    for (s64 i = 0; i < samples; i++) signal[i] = dist(mt);
+
+    for (int threads = 1; threads <= 3; threads += 2)
+        for (int output = STFT::POWER; output <= STFT::MAGNITUDE; output++)
+        {
+            STFT stft;
+            stft.SetFrame(factors, hop);
+            stft.SetThreads(threads);
+            s64 frames = stft.Frames(samples);
+            s64 bins = stft.Bins();
+            std::vector<Data> out(frames * bins);
+            bool ok = bins == N / 2 + 1 && stft.Process(signal.data(), samples, out.data(), output) == frames;
+
+            Data maxError = 0;
+            DataBuffer real(N), imag(N);
+            for (s64 f = 0; f < frames; f++) {
+                for (s64 n = 0; n < N; n++) {
+                    Data w = (Data)(0.5L - 0.5L * std::cos(2.0L * 3.141592653589793238462643383279503L * n / N));
+                    real[n] = w * signal[f * hop + n];
+                    imag[n] = 0;
+                }
+                pf.forwardFFT(real, imag);
+                for (s64 k = 0; k < bins; k++) {
+                    Data expected = real[k] * real[k] + imag[k] * imag[k];
+                    if (output == STFT::MAGNITUDE) expected = std::sqrt(expected);
+                    Data e = std::fabs(out[f * bins + k] - expected);
+                    if (e > maxError) maxError = e;
+                }
+            }
+            if (!(maxError < 1e-9)) ok = false;
+
+            std::cout << frames << " frames " << threads << " threads " << ((output == STFT::POWER) ? "power" : "magnitude")
+                << " max error " << maxError << (ok ? "" : "  FAILED") << std::endl;
+            if (!ok) failed++;
+        }
+    std::cout << "Test12STFT end " << std::endl << std::endl;
+    return failed;
+}
+
+/*
+    SlidingDFT against the transform of the last N samples of the stream,
+    after many single sample slides without a resync, with the default
+    resync, and after blocks long enough to go in as a full transform.
+    Complex and real streams. Returns the number of failures.
+*/
+int test13SlidingDFT()
+{
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    factorSeq factors = { 3, 5, 7 };
+    PrimeFactorDFT pf;
+    pf.SetFactors(factors);
+    s64 N = pf.Status();
+    const s64 samples = 50 * N;
+    int failed = 0;
+
+    std::cout << "Test13SlidingDFT begin " << std::endl;
+    std::vector<Data> streamReal(samples), streamImag(samples);
+    for (s64 i = 0; i < samples; i++) {
+        streamReal[i] = dist(mt);
+        streamImag[i] = dist(mt);
+    }
+
+    /* resync, largest piece pushed at once, complex */
+    static const s64 runs[][3] = { { samples, 1, 1 }, { 0, 7, 1 }, { samples, 1, 0 }, { samples, 3 * N, 1 } };
+    for (std::size_t r = 0; r < sizeof(runs) / sizeof(runs[0]); r++)
+    {
+        SlidingDFT sliding;
+        sliding.SetLength(factors, runs[r][0]);
+        const Data* imag = runs[r][2] ? streamImag.data() : 0;
+        std::uniform_int_distribution<s64> piece(1, runs[r][1]);
+
+        Data maxError = 0;
+        DataBuffer real(N), im(N);
+        /* checked every 17th push */
+        for (s64 t = 0, pushes = 0; t < samples; pushes++) {
+            s64 n = piece(mt);
+            if (n > samples - t) n = samples - t;
+            sliding.Push(streamReal.data() + t, imag ? imag + t : 0, n);
+            t += n;
+            if (t < N || pushes % 17 != 0) continue;
+
+            for (s64 i = 0; i < N; i++) {
+                real[i] = streamReal[t - N + i];
+                im[i] = imag ? imag[t - N + i] : 0;
+            }
+            pf.forwardFFT(real, im);
+            for (s64 k = 0; k < N; k++) {
+                Data e = std::fabs(sliding.SpectrumReal()[k] - real[k]) + std::fabs(sliding.SpectrumImag()[k] - im[k]);
+                if (e > maxError) maxError = e;
+            }
+        }
+
+        bool ok = maxError < 1e-9;
+        std::cout << "resync " << (runs[r][0] ? runs[r][0] : N) << " pieces up to " << runs[r][1] << (runs[r][2] ? " complex" : " real")
+            << " max error " << maxError << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
+    std::cout << "Test13SlidingDFT end " << std::endl << std::endl;
+    return failed;
+}
+
+/* the FFTW definitions, REDFT00 ... RODFT11, evaluated directly */
+static long double TrigDefinition(int type, const Data* x, s64 N, s64 k)
+{
+    const long double pi = 3.141592653589793238462643383279503L;
+    long double y = 0;
+    switch (type) {
+    case TrigTransform::DCT1:
+        y = x[0] + ((k % 2) ? -1.0L : 1.0L) * x[N - 1];
+        for (s64 n = 1; n < N - 1; n++) y += 2 * x[n] * std::cos(pi * n * k / (N - 1));
+        break;
+    case TrigTransform::DCT2:
+        for (s64 n = 0; n < N; n++) y += 2 * x[n] * std::cos(pi * (n + 0.5L) * k / N);
+        break;
+    case TrigTransform::DCT3:
+        y = x[0];
+        for (s64 n = 1; n < N; n++) y += 2 * x[n] * std::cos(pi * n * (k + 0.5L) / N);
+        break;
+    case TrigTransform::DCT4:
+        for (s64 n = 0; n < N; n++) y += 2 * x[n] * std::cos(pi * (n + 0.5L) * (k + 0.5L) / N);
+        break;
+    case TrigTransform::DST1:
+        for (s64 n = 0; n < N; n++) y += 2 * x[n] * std::sin(pi * (n + 1) * (k + 1) / (N + 1));
+        break;
+    case TrigTransform::DST2:
+        for (s64 n = 0; n < N; n++) y += 2 * x[n] * std::sin(pi * (n + 0.5L) * (k + 1) / N);
+        break;
+    case TrigTransform::DST3:
+        y = ((k % 2) ? -1.0L : 1.0L) * x[N - 1];
+        for (s64 n = 0; n < N - 1; n++) y += 2 * x[n] * std::sin(pi * (n + 1) * (k + 0.5L) / N);
+        break;
+    case TrigTransform::DST4:
+        for (s64 n = 0; n < N; n++) y += 2 * x[n] * std::sin(pi * (n + 0.5L) * (k + 0.5L) / N);
+        break;
+    }
+    return y;
+}
+
+/*
+    DCT-IV and DST-IV bin k directly, the angle pi (2n + 1)(2k + 1) / 4N
+    reduced modulo 2 pi in integers, so long N do not lose the reference.
+*/
+static long double TypeFourDefinition(bool sine, const Data* x, s64 N, s64 k)
+{
+    const long double pi = 3.141592653589793238462643383279503L;
+    long double y = 0;
+    for (s64 n = 0; n < N; n++) {
+        s64 m = ((2 * n + 1) * (2 * k + 1)) % (8 * N);
+        long double a = pi * m / (4 * N);
+        y += 2 * x[n] * (sine ? std::sin(a) : std::cos(a));
+    }
+    return y;
+}
+
+/*
+    TrigTransform against the O(N^2) definitions for all eight types, two
+    sequences at once, and the round trip through the inverse type, which
+    gives back the input times 2N, 2(N - 1) for DCT-I and 2(N + 1) for DST-I.
+    Then DCT-IV and DST-IV at N = 255255 against the definition on 24 bins
+    spread over the output, within 1e-14 of the largest of them.
+    Returns the number of failures.
+*/
+int test14TrigTransform()
+{
+    static const char* names[] = { "DCT-I", "DCT-II", "DCT-III", "DCT-IV", "DST-I", "DST-II", "DST-III", "DST-IV" };
+    static const int inverse[] = { TrigTransform::DCT1, TrigTransform::DCT3, TrigTransform::DCT2, TrigTransform::DCT4,
+                                   TrigTransform::DST1, TrigTransform::DST3, TrigTransform::DST2, TrigTransform::DST4 };
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    int failed = 0;
+
+    std::cout << "Test14TrigTransform begin " << std::endl;
+    for (int type = TrigTransform::DCT1; type <= TrigTransform::DST4; type++)
+    {
+        /* type I gets the length of the extension, 210 */
+        bool one = type == TrigTransform::DCT1 || type == TrigTransform::DST1;
+        factorSeq factors = one ? factorSeq{ 2, 3, 5, 7 } : factorSeq{ 3, 5, 7 };
+
+        TrigTransform forward, backward;
+        s64 N = forward.SetType(type, factors);
+        bool ok = N > 0 && backward.SetType(inverse[type], factors) == N;
+        if (!ok) { std::cout << names[type] << "  FAILED" << std::endl; failed++; continue; }
+
+        std::vector<Data> x(N), y(N), X(N), Y(N);
+        for (s64 n = 0; n < N; n++) { X[n] = x[n] = dist(mt); Y[n] = y[n] = dist(mt); }
+
+        forward.Evaluate(X.data(), Y.data());
+        Data maxError = 0;
+        for (s64 k = 0; k < N; k++) {
+            Data e = (Data)std::fabs(X[k] - TrigDefinition(type, x.data(), N, k));
+            Data f = (Data)std::fabs(Y[k] - TrigDefinition(type, y.data(), N, k));
+            if (e > maxError) maxError = e;
+            if (f > maxError) maxError = f;
+        }
+
+        backward.Evaluate(X.data(), Y.data());
+        Data scale = (type == TrigTransform::DCT1) ? 2 * (N - 1) : (type == TrigTransform::DST1) ? 2 * (N + 1) : 2 * N;
+        Data roundTrip = 0;
+        for (s64 n = 0; n < N; n++) {
+            Data e = std::fabs(X[n] / scale - x[n]) + std::fabs(Y[n] / scale - y[n]);
+            if (e > roundTrip) roundTrip = e;
+        }
+
+        ok = maxError < 1e-12 && roundTrip < 1e-12;
+        std::cout << names[type] << " N " << N << " max error " << maxError << " round trip " << roundTrip << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
+
+    factorSeq large = { 3, 5, 7, 11, 13, 17 };
+    for (int type = TrigTransform::DCT4; type <= TrigTransform::DST4; type += TrigTransform::DST4 - TrigTransform::DCT4)
+    {
+        TrigTransform trig;
+        s64 N = trig.SetType(type, large);
+        std::vector<Data> x(N), X(N);
+        for (s64 n = 0; n < N; n++) X[n] = x[n] = dist(mt);
+        trig.Evaluate(X.data());
+
+        Data largest = 0, maxError = 0;
+        for (s64 b = 0; b < 24; b++) {
+            s64 k = (b * 10631 + b * b) % N;
+            long double expected = TypeFourDefinition(type == TrigTransform::DST4, x.data(), N, k);
+            largest = std::max(largest, (Data)std::fabs(expected));
+            maxError = std::max(maxError, (Data)std::fabs(X[k] - expected));
+        }
+        bool ok = maxError < 1e-14 * largest;
+        std::cout << names[type] << " N " << N << " relative error " << maxError / largest << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
+    std::cout << "Test14TrigTransform end " << std::endl << std::endl;
+    return failed;
+}
+
+/*
+    OutOfCoreDFT against forwardFFT in memory, with a memory budget of a few
+    pages so the stages go in many chunks. The file is closed and opened again
+    between the transform and the scaled inverse. Returns the number of failures.
+*/
+int test15OutOfCoreDFT()
+{
+    static const char* path = "OutOfCoreDFT.test";
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    factorSeq factors = { 3, 5, 7, 11, 13 };
+    PrimeFactorDFT pf;
+    pf.SetFactors(factors);
+    s64 N = pf.Status();
+
+    std::cout << "Test15OutOfCoreDFT begin " << std::endl;
+    OutOfCoreDFT file;
+    if (file.Open(path, factors, true) != N) {
+#ifdef NOTWIN
+        std::cout << "can not map " << path << "  FAILED" << std::endl << "Test15OutOfCoreDFT end " << std::endl << std::endl;
+        return 1;
+#else
+        std::cout << "not available" << std::endl << "Test15OutOfCoreDFT end " << std::endl << std::endl;
+        return 0;
+#endif
+    }
+
+    DataBuffer real(N), imag(N), input(2 * N);
+    for (s64 i = 0; i < N; i++) {
+        input[i] = file.Real()[i] = real[i] = dist(mt);
+        input[N + i] = file.Imag()[i] = imag[i] = dist(mt);
+    }
+    file.SetMemory(16 * 4096);
+    file.forwardFFT();
+    pf.forwardFFT(real, imag);
+
+    bool ok = true;
+    for (s64 i = 0; i < N; i++)
+        if (file.Real()[i] != real[i] || file.Imag()[i] != imag[i]) ok = false;
+
+    file.Close();
+    ok = ok && file.Open(path, factors) == N;
+    Data maxError = 0;
+    if (ok) {
+        file.ScaledInverseFFT();
+        for (s64 i = 0; i < N; i++) {
+            Data e = std::fabs(file.Real()[i] - input[i]) + std::fabs(file.Imag()[i] - input[N + i]);
+            if (e > maxError) maxError = e;
+        }
+        file.Close();
+    }
+    std::remove(path);
+
+    ok = ok && maxError < 1e-13;
+    std::cout << "N " << N << " round trip " << maxError << (ok ? "" : "  FAILED") << std::endl;
+    std::cout << "Test15OutOfCoreDFT end " << std::endl << std::endl;
+    return ok ? 0 : 1;
+}
+
+/* how often key appears in text */
+static int Occurrences(const std::string& text, const std::string& key)
+{
+    int n = 0;
+    for (std::size_t at = text.find(key); at != std::string::npos; at = text.find(key, at + 1)) n++;
+    return n;
+}
+
+/*
+    StageProfiler on a small transform: the profiled runs give the result of
+    forwardFFT, the records have the factors, butterflies, operations from
+    ModuleCosts and bytes of each stage, and the JSON dump has every field
+    once per stage, the right values and balanced brackets.
+    Returns the number of failures.
+*/
+int test16StageProfiler()
+{
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    factorSeq factors = { 3, 5, 7 };
+    PrimeFactorDFT pf;
+    pf.SetFactors(factors);
+    s64 N = pf.Status();
+    const int runs = 3;
+
+    std::cout << "Test16StageProfiler begin " << std::endl;
+    DataBuffer real(N), imag(N), refReal(N), refImag(N);
+    for (s64 i = 0; i < N; i++) {
+        refReal[i] = real[i] = dist(mt);
+        refImag[i] = imag[i] = dist(mt);
+    }
+    for (int r = 0; r < runs; r++) pf.forwardFFT(refReal, refImag);
+
+    StageProfiler profiler;
+    bool ok = true;
+    for (int r = 0; r < runs; r++)
+        if (profiler.forwardFFT(pf, real, imag) != (s64)factors.size()) ok = false;
+    for (s64 i = 0; i < N; i++)
+        if (real[i] != refReal[i] || imag[i] != refImag[i]) ok = false;
+    if (!ok) std::cout << "profiled transform differs  FAILED" << std::endl;
+
+    const std::vector<StageRecord>& records = profiler.Records();
+    s64 operations = 0;
+    ok = ok && profiler.Runs() == runs && records.size() == factors.size();
+    for (std::size_t s = 0; ok && s < records.size(); s++) {
+        const StageRecord& rec = records[s];
+        if (rec.factor != factors[s] || rec.butterflies != N / factors[s]
+            || rec.operations != rec.butterflies * ModuleCostOf(factors[s]).Operations()
+            || rec.bytes != 4 * N * (s64)sizeof(Data) || !(rec.seconds >= 0)) ok = false;
+        operations += rec.operations;
+    }
+    if (operations != pf.Operations()) ok = false;
+
+    std::ostringstream json;
+    profiler.WriteJSON(json);
+    std::string text = json.str();
+    int stages = (int)factors.size();
+    static const char* fields[] = { "\"stage\": ", "\"factor\": ", "\"butterflies\": ", "\"operations\": ",
+                                    "\"bytes\": ", "\"seconds\": ", "\"opsPerByte\": " };
+    static const char* counters[] = { "\"instructions\": ", "\"cycles\": ", "\"cacheMisses\": " };
+    for (std::size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++)
+        if (Occurrences(text, fields[f]) != stages) ok = false;
+    for (std::size_t f = 0; f < sizeof(counters) / sizeof(counters[0]); f++)
+        if (Occurrences(text, counters[f]) != (profiler.Counters() ? stages : 0)) ok = false;
+    if (Occurrences(text, "\"length\": " + std::to_string(N) + ",") != 1
+        || Occurrences(text, "\"runs\": " + std::to_string(runs) + ",") != 1
+        || Occurrences(text, "\"stages\": [") != 1) ok = false;
+    for (int s = 0; s < stages; s++)
+        if (Occurrences(text, "{\"stage\": " + std::to_string(s) + ", \"factor\": " + std::to_string(factors[s]) + ",") != 1) ok = false;
+    int depth = 0;
+    for (std::size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '{' || text[i] == '[') depth++;
+        if (text[i] == '}' || text[i] == ']') depth--;
+        if (depth < 0) ok = false;
+    }
+    if (depth != 0 || Occurrences(text, "{") != stages + 1) ok = false;
+
+    std::cout << text << "stages " << records.size() << " runs " << profiler.Runs() << (ok ? "" : "  FAILED") << std::endl;
+    std::cout << "Test16StageProfiler end " << std::endl << std::endl;
+    return ok ? 0 : 1;
+}
+
+/*
+    Roofline of the transforms. The machine is measured first: the bandwidth
+    of a STREAM triad a = b + s * c over arrays far larger than the caches,
+    and the peak rate of multiply-adds on independent chains, once scalar
+    and once on vectors of 4, compiled like the modules (PFA_KERNEL). A stage
+    reads and writes real and imag once, so its operations per byte is
+    ops / (4 * N * sizeof(Data)) and it can at best reach
+    min(peak, bandwidth * ops per byte). The modules are scalar code, so
+    the scalar peak is the roof, the vector peak is what vectorizing them
+    could give. Everything runs on one thread, as the transforms do. Lengths
+    whose data fits in the caches can beat the memory roof.
+*/
+#define TRIADLENGTH (1 << 25)
+#define PEAKCHAINS 12
+#define PEAKROUNDS (1 << 24)
+#define BENCHSECONDS 0.2
+
+static double Seconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* bytes per second, best of 5 */
+double StreamBandwidth()
+{
+    DataBuffer a(TRIADLENGTH), b(TRIADLENGTH), c(TRIADLENGTH);
+    for (s64 i = 0; i < TRIADLENGTH; i++) { b[i] = 1.0; c[i] = 2.0; }
+
+    double best = 0;
+    for (int run = 0; run < 5; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Data scale = 0.5 + run;
+        for (s64 i = 0; i < TRIADLENGTH; i++) a[i] = b[i] + scale * c[i];
+        double rate = 3.0 * TRIADLENGTH * sizeof(Data) / Seconds(start);
+        if (rate > best) best = rate;
+    }
+    /* keep the triad */
+    if (a[TRIADLENGTH / 2] < 0) std::cout << a[0];
+    return best;
+}
+
+/* operations per second, one multiply-add is 2 */
+#ifdef __GNUC__
+__attribute__((optimize("no-tree-vectorize")))
+#endif
+PFA_KERNEL double ScalarPeak(Data a, Data b)
+{
+    Data x[PEAKCHAINS];
+    for (int j = 0; j < PEAKCHAINS; j++) x[j] = (Data)j;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (s64 r = 0; r < PEAKROUNDS; r++)
+        for (int j = 0; j < PEAKCHAINS; j++) x[j] = x[j] * a + b;
+    double seconds = Seconds(start);
+
+    Data sum = 0;
+    for (int j = 0; j < PEAKCHAINS; j++) sum += x[j];
+    if (sum < 0) std::cout << sum;
+    return 2.0 * PEAKCHAINS * PEAKROUNDS / seconds;
+}
+
+#if defined(__GNUC__) && !defined(PFA_LONG_DOUBLE)
+typedef Data DataVector __attribute__((vector_size(4 * sizeof(Data))));
+
+PFA_KERNEL double VectorPeak(Data a, Data b)
+{
+    DataVector x[PEAKCHAINS];
+    DataVector va = { a, a, a, a };
+    DataVector vb = { b, b, b, b };
+    for (int j = 0; j < PEAKCHAINS; j++) x[j] = DataVector{ (Data)j, (Data)j + 1, (Data)j + 2, (Data)j + 3 };
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (s64 r = 0; r < PEAKROUNDS; r++)
+        for (int j = 0; j < PEAKCHAINS; j++) x[j] = x[j] * va + vb;
+    double seconds = Seconds(start);
+
+    Data sum = 0;
+    for (int j = 0; j < PEAKCHAINS; j++) sum += x[j][0] + x[j][1] + x[j][2] + x[j][3];
+    if (sum < 0) std::cout << sum;
+    return 8.0 * PEAKCHAINS * PEAKROUNDS / seconds;
+}
+#else
+double VectorPeak(Data a, Data b) { return ScalarPeak(a, b); }
+#endif
+
+void testRoofline()
+{
+    std::cout << "TestRoofline begin " << std::endl;
+
+    double bandwidth = StreamBandwidth();
+    double peak = ScalarPeak(0.999999, 1e-6);
+    double vectorPeak = VectorPeak(0.999999, 1e-6);
+    std::cout << "kernels " << PrimeFactorDFT::KernelVariant()
+        << "  bandwidth " << bandwidth / 1e9 << " GB/s"
+        << "  scalar peak " << peak / 1e9 << " GFlop/s"
+        << "  vector peak " << vectorPeak / 1e9 << " GFlop/s"
+        << "  ridge " << peak / bandwidth << " ops/byte" << std::endl;
+
+    for (std::size_t m = 0; m < sizeof(ModuleCosts) / sizeof(ModuleCosts[0]); m++) {
+        const ModuleCost& cost = ModuleCosts[m];
+        std::cout << "  DFT" << cost.factor
+            << "  adds " << cost.additions << "  muls " << cost.multiplications
+            << "  ops/point " << (double)cost.Operations() / cost.factor
+            << "  ops/byte " << (double)cost.Operations() / ((cost.loads + cost.stores) * sizeof(Data))
+            << "  live values " << cost.liveValues << std::endl;
+    }
+
+    static const uint sets[][8] = {
+        { 3, 5, 7, 11, 0 },
+        { 2, 3, 5, 7, 11, 13, 0 },
+        { 2, 3, 5, 7, 11, 13, 17, 0 },
+        { 2, 3, 5, 7, 11, 13, 17, 19 } };
+
+    for (std::size_t set = 0; set < sizeof(sets) / sizeof(sets[0]); set++)
+    {
+        factorSeq factors;
+        for (int j = 0; j < 8 && sets[set][j] != 0; j++) factors.push_back(sets[set][j]);
+
+        PrimeFactorDFT pf;
+        pf.SetFactors(factors);
+        s64 N = pf.Status();
+
+        DataBuffer real(N), imag(N);
+        for (s64 i = 0; i < N; i++) real[i] = (Data)(i % 7) - 3;
+
+        /* one to warm up, then as many as fit in BENCHSECONDS */
+        StageProfiler profiler;
+        profiler.forwardFFT(pf, real, imag);
+        profiler.Clear();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        do profiler.forwardFFT(pf, real, imag);
+        while (Seconds(start) < BENCHSECONDS);
+
+        const std::vector<StageRecord>& records = profiler.Records();
+        double runs = (double)profiler.Runs();
+        double seconds = 0, best = 0;
+        std::cout << "N " << N << std::endl;
+        for (std::size_t s = 0; s < records.size(); s++)
+        {
+            double t = records[s].seconds / runs;
+            double intensity = (double)records[s].operations / records[s].bytes;
+            double roof = (intensity * bandwidth < peak) ? intensity * bandwidth : peak;
+            double achieved = records[s].operations / t;
+            seconds += t;
+            best += records[s].operations / roof;
+            std::cout << "  factor " << records[s].factor
+                << "  ops/byte " << intensity
+                << "  GFlop/s " << achieved / 1e9
+                << "  roof " << roof / 1e9
+                << "  " << 100.0 * achieved / roof << "% "
+                << ((roof < peak) ? "memory" : "compute") << " bound" << std::endl;
+        }
+        std::cout << "  transform " << seconds * 1e3 << " ms  GFlop/s " << pf.Operations() / seconds / 1e9
+            << "  roof " << pf.Operations() / best / 1e9
+            << "  " << 100.0 * best / seconds << "% of the roof" << std::endl;
+    }
+    std::cout << "TestRoofline end " << std::endl << std::endl;
+}
+
+
+/*
+    ThreadPool without workers and with three: ParallelFor covers every index
+    of a range exactly once in at most the chunks asked for, also nested in a
+    task; Submit without workers runs the task before returning; all submitted
+    tasks run. A plan on the pool, long enough to split its stages, gives the
+    same transforms bit for bit as without, plain and pruned.
+    Returns the number of failures.
+*/
+int test17ThreadPool()
+{
+    static const s64 chunkCounts[] = { 0, 1, 7, 1000 };
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    int failed = 0;
+
+    std::cout << "Test17ThreadPool begin " << std::endl;
+    for (int workers = 0; workers <= 3; workers += 3)
+    {
+        ThreadPool pool(workers);
+        bool ok = pool.Workers() == workers;
+
+        const s64 range = 100000;
+        for (std::size_t c = 0; c < sizeof(chunkCounts) / sizeof(chunkCounts[0]); c++) {
+            std::vector<int> visits(range, 0);
+            std::atomic<s64> calls(0);
+            pool.ParallelFor(0, range, chunkCounts[c], [&visits, &calls](s64 first, s64 last) {
+                calls++;
+                for (s64 i = first; i < last; i++) visits[i]++;
+            });
+            s64 most = chunkCounts[c] ? chunkCounts[c] : workers + 1;
+            if (calls > most) ok = false;
+            for (s64 i = 0; i < range; i++)
+                if (visits[i] != 1) ok = false;
+        }
+
+        bool ran = false;
+        if (workers == 0) {
+            pool.Submit([&ran] { ran = true; });
+            if (!ran) ok = false;
+        }
+
+        /* tasks, each with a ParallelFor of its own */
+        const int tasks = 50;
+        std::atomic<int> done(0);
+        std::atomic<s64> sum(0);
+        for (int t = 0; t < tasks; t++)
+            pool.Submit([&pool, &done, &sum] {
+                pool.ParallelFor(0, 1000, 4, [&sum](s64 first, s64 last) {
+                    for (s64 i = first; i < last; i++) sum += i;
+                });
+                done++;
+            });
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        while (done < tasks && Seconds(start) < 30)
+            if (!pool.RunPending()) std::this_thread::yield();
+        if (done != tasks || sum != (s64)tasks * 999 * 1000 / 2) ok = false;
+
+        /* 39270 points, over POOLLIMIT */
+        factorSeq factors = { 2, 3, 5, 7, 11, 17 };
+        PrimeFactorDFT pooled, serial;
+        pooled.SetFactors(factors);
+        serial.SetFactors(factors);
+        pooled.SetPool(&pool);
+        s64 N = serial.Status();
+        PrunedStages pruning;
+        pooled.Prune(0, N / 3, 0, N, pruning);
+
+        DataBuffer real(N), imag(N), sreal(N), simag(N);
+        for (int run = 0; run < 3; run++) {
+            for (s64 i = 0; i < N; i++) {
+                sreal[i] = real[i] = (run < 2 || i < N / 3) ? dist(mt) : 0;
+                simag[i] = imag[i] = (run < 2 || i < N / 3) ? dist(mt) : 0;
+            }
+            if (run == 0) { pooled.forwardFFT(real, imag); serial.forwardFFT(sreal, simag); }
+            if (run == 1) { pooled.InverseFFT(real, imag); serial.InverseFFT(sreal, simag); }
+            if (run == 2) { pooled.forwardFFT(real, imag, pruning); serial.forwardFFT(sreal, simag, pruning); }
+            for (s64 i = 0; i < N; i++)
+                if (real[i] != sreal[i] || imag[i] != simag[i]) ok = false;
+        }
+
+        std::cout << workers << " workers" << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
+    std::cout << "Test17ThreadPool end " << std::endl << std::endl;
+    return failed;
+}
+
+/*
+    Several forwardFFTAsync and InverseFFTAsync on one plan, on buffers of
+    their own, against the synchronous transforms, while the calling thread
+    runs a transform with a sink on the same plan. Every callback must run
+    once before its future is ready. With three workers and with none.
+    Returns the number of failures.
+*/
+int test18Async()
+{
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    factorSeq factors = { 2, 3, 5, 7, 11, 17 };
+    PrimeFactorDFT serial;
+    serial.SetFactors(factors);
+    s64 N = serial.Status();
+    const int transforms = 6;
+    int failed = 0;
+
+    std::cout << "Test18Async begin " << std::endl;
+    for (int workers = 0; workers <= 3; workers += 3)
+    {
+        ThreadPool pool(workers);
+        PrimeFactorDFT pf;
+        pf.SetFactors(factors);
+        pf.SetPool(&pool);
+
+        std::vector<DataBuffer*> buffers, expected;
+        for (int t = 0; t < 2 * (transforms + 1); t++) {
+            buffers.push_back(new DataBuffer(N));
+            expected.push_back(new DataBuffer(N));
+            for (s64 i = 0; i < N; i++) (*expected[t])[i] = (*buffers[t])[i] = dist(mt);
+        }
+        for (int t = 0; t < transforms; t++) {
+            if (t % 2) serial.InverseFFT(*expected[2 * t], *expected[2 * t + 1]);
+            else serial.forwardFFT(*expected[2 * t], *expected[2 * t + 1]);
+        }
+        TopKPeaks expectedPeaks(3);
+        serial.forwardFFT(*expected[2 * transforms], *expected[2 * transforms + 1], &expectedPeaks, false);
+
+        std::atomic<int> callbacks(0);
+        std::vector<int> calledBeforeReady(transforms, 0);
+        std::vector< std::future<void> > futures;
+        for (int t = 0; t < transforms; t++) {
+            std::function<void()> done = [&callbacks, &calledBeforeReady, t] { callbacks++; calledBeforeReady[t]++; };
+            if (t % 2) futures.push_back(pf.InverseFFTAsync(*buffers[2 * t], *buffers[2 * t + 1], done));
+            else futures.push_back(pf.forwardFFTAsync(*buffers[2 * t], *buffers[2 * t + 1], done));
+        }
+
+        /* on the same plan while the others run */
+        TopKPeaks peaks(3);
+        pf.forwardFFT(*buffers[2 * transforms], *buffers[2 * transforms + 1], &peaks, false);
+
+        bool ok = true;
+        for (int t = 0; t < transforms; t++) {
+            futures[t].wait();
+            if (calledBeforeReady[t] != 1) ok = false;
+        }
+        if (callbacks != transforms) ok = false;
+
+        for (int t = 0; t < 2 * transforms; t++)
+            for (s64 i = 0; i < N; i++)
+                if ((*buffers[t])[i] != (*expected[t])[i]) ok = false;
+
+        std::vector<Peak> best, expectedBest;
+        peaks.Result(best);
+        expectedPeaks.Result(expectedBest);
+        if (best.size() != expectedBest.size()) ok = false;
+        for (std::size_t k = 0; ok && k < best.size(); k++)
+            if (best[k].index != expectedBest[k].index || best[k].value != expectedBest[k].value) ok = false;
+
+        for (std::size_t t = 0; t < buffers.size(); t++) { delete buffers[t]; delete expected[t]; }
+
+        std::cout << transforms << " transforms in flight, " << workers << " workers" << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
+    std::cout << "Test18Async end " << std::endl << std::endl;
+    return failed;
+}
+
+/* an item of the pipeline of test19Pipeline */
+struct PipelineItem {
+    int id;
+    DataBuffer real;
+    DataBuffer imag;
+};
+
+static PipelineTask PipelineSource(std::vector<PipelineItem*>& items, Channel<PipelineItem*>& out)
+{
+    for (std::size_t i = 0; i < items.size(); i++) co_await out.Push(items[i]);
+    out.Close();
+}
+
+/* forward transform and the product with the spectrum of a kernel */
+static PipelineTask PipelineForward(PrimeFactorDFT& pf, Data* kernelReal, Data* kernelImag,
+                                    Channel<PipelineItem*>& in, Channel<PipelineItem*>& out, ThreadPool* pool)
+{
+    while (std::optional<PipelineItem*> item = co_await in.Pop()) {
+        PipelineItem* it = *item;
+        co_await ForwardFFTStep(pf, it->real, it->imag);
+        s64 N = pf.Status();
+        co_await ComputeStep([it, N, kernelReal, kernelImag] {
+            Multiply(N, it->real, it->imag, it->real, it->imag, kernelReal, kernelImag);
+        }, pool);
+        co_await out.Push(it);
+    }
+    out.Close();
+}
+
+static PipelineTask PipelineInverse(PrimeFactorDFT& pf, Channel<PipelineItem*>& in, Channel<PipelineItem*>& out)
+{
+    while (std::optional<PipelineItem*> item = co_await in.Pop()) {
+        co_await ScaledInverseFFTStep(pf, (*item)->real, (*item)->imag);
+        co_await out.Push(*item);
+    }
+    out.Close();
+}
+
+static PipelineTask PipelineCollect(Channel<PipelineItem*>& in, std::vector<int>& order)
+{
+    while (std::optional<PipelineItem*> item = co_await in.Pop()) order.push_back((*item)->id);
+}
+
+/*
+    20 items through a pipeline of four stages joined by channels of
+    capacity 2: forward transform and product with a kernel spectrum,
+    scaled inverse, collect. Every item must come out once, in order, equal
+    to the same steps run directly. With no workers and with four.
+    Returns the number of failures.
+*/
+int test19Pipeline()
+{
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    factorSeq factors = { 2, 3, 5, 7, 11, 17 };
+    PrimeFactorDFT serial;
+    serial.SetFactors(factors);
+    s64 N = serial.Status();
+    const int count = 20;
+    int failed = 0;
+
+    std::cout << "Test19Pipeline begin " << std::endl;
+    DataBuffer kernelReal(N), kernelImag(N);
+    for (s64 i = 0; i < 16; i++) kernelReal[i] = dist(mt);
+    serial.forwardFFT(kernelReal, kernelImag);
+
+    for (int workers = 0; workers <= 4; workers += 4)
+    {
+        ThreadPool pool(workers);
+        PrimeFactorDFT pf;
+        pf.SetFactors(factors);
+        pf.SetPool(&pool);
+
+        std::vector<PipelineItem*> items;
+        std::vector<DataBuffer*> expected;
+        for (int i = 0; i < count; i++) {
+            PipelineItem* item = new PipelineItem;
+            item->id = i;
+            item->real.Allocate(N);
+            item->imag.Allocate(N);
+            expected.push_back(new DataBuffer(2 * N));
+            Data* er = *expected[i];
+            Data* ei = er + N;
+            for (s64 n = 0; n < N; n++) {
+                er[n] = item->real[n] = dist(mt);
+                ei[n] = item->imag[n] = dist(mt);
+            }
+            serial.forwardFFT(er, ei);
+            Multiply(N, er, ei, er, ei, kernelReal, kernelImag);
+            serial.ScaledInverseFFT(er, ei);
+            items.push_back(item);
+        }
+
+        std::vector<int> order;
+        {
+            Channel<PipelineItem*> loaded(2, &pool), multiplied(2, &pool), done(2, &pool);
+            Pipeline pipeline(&pool);
+            pipeline.Start(PipelineSource(items, loaded));
+            pipeline.Start(PipelineForward(pf, kernelReal, kernelImag, loaded, multiplied, &pool));
+            pipeline.Start(PipelineInverse(pf, multiplied, done));
+            pipeline.Start(PipelineCollect(done, order));
+            pipeline.Wait();
+        }
+
+        bool ok = (int)order.size() == count;
+        for (int i = 0; ok && i < count; i++) {
+            if (order[i] != i) ok = false;
+            for (s64 n = 0; n < N; n++)
+                if (items[i]->real[n] != (*expected[i])[n] || items[i]->imag[n] != (*expected[i])[N + n]) ok = false;
+        }
+        for (int i = 0; i < count; i++) { delete items[i]; delete expected[i]; }
+
+        std::cout << count << " items, " << workers << " workers" << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
+    std::cout << "Test19Pipeline end " << std::endl << std::endl;
+    return failed;
+}
+
+/*
+    SharedMemoryDFT on one to four worker processes, pinned to the nodes
+    for an even count: the forward transform must equal PrimeFactorDFT's
+    exactly and the round trip stay under 1e-13. Then a worker is killed,
+    the transforms after it must fail within seconds instead of hanging.
+    Returns the number of failures.
+*/
+int test20SharedMemoryDFT()
+{
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    factorSeq factors = { 3, 5, 7, 11, 13 };
+    PrimeFactorDFT pf;
+    pf.SetFactors(factors);
+    s64 N = pf.Status();
+    int failed = 0;
+
+    std::cout << "Test20SharedMemoryDFT begin " << std::endl;
+#ifdef NOTWIN
+    DataBuffer real(N), imag(N), input(2 * N);
+    for (int processes = 1; processes <= 4; processes++)
+    {
+        SharedMemoryDFT shared;
+        bool pin = processes % 2 == 0;
+        bool ok = shared.Open(factors, processes, pin) == N && shared.Processes() == processes;
+        Data maxError = 0;
+        if (ok) {
+            for (s64 i = 0; i < N; i++) {
+                input[i] = shared.Real()[i] = real[i] = dist(mt);
+                input[N + i] = shared.Imag()[i] = imag[i] = dist(mt);
+            }
+            ok = shared.forwardFFT();
+            pf.forwardFFT(real, imag);
+            for (s64 i = 0; i < N; i++)
+                if (shared.Real()[i] != real[i] || shared.Imag()[i] != imag[i]) ok = false;
+
+            ok = shared.ScaledInverseFFT() && ok;
+            for (s64 i = 0; i < N; i++) {
+                Data e = std::fabs(shared.Real()[i] - input[i]) + std::fabs(shared.Imag()[i] - input[N + i]);
+                if (e > maxError) maxError = e;
+            }
+            ok = ok && maxError < 1e-13;
+        }
+        shared.Close();
+        std::cout << processes << " processes" << (pin ? " pinned" : "") << ", round trip " << maxError << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
+
+    /* a killed worker fails the transform, it does not hang */
+    {
+        SharedMemoryDFT shared;
+        bool ok = shared.Open(factors, 2, false) == N;
+        if (ok) {
+            kill(shared.ProcessId(1), SIGKILL);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            ok = !shared.forwardFFT() && shared.Processes() == 0 && !shared.InverseFFT();
+            shared.Close();
+            ok = ok && Seconds(start) < 10;
+        }
+        std::cout << "killed worker" << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
+#else
+    (void)dist;
+    (void)N;
+    std::cout << "not available" << std::endl;
+#endif
+    std::cout << "Test20SharedMemoryDFT end " << std::endl << std::endl;
+    return failed;
+}
+
+/*
+    Transforms the lines of one axis of a row major array one by one,
+    gathered into a contiguous buffer.
+*/
+static void AxisLines(PrimeFactorDFT& plan, Data* real, Data* imag, s64 size, s64 stride, int direction)
+{
+    s64 length = plan.Status();
+    DataBuffer lineReal(length), lineImag(length);
+    for (s64 l = 0; l < size / length; l++) {
+        Data* r = real + (l / stride) * stride * length + l % stride;
+        Data* i = imag + (r - real);
+        for (s64 n = 0; n < length; n++) { lineReal[n] = r[n * stride]; lineImag[n] = i[n * stride]; }
+        if (direction == 0) plan.forwardFFT(lineReal, lineImag);
+        else plan.InverseFFT(lineReal, lineImag);
+        for (s64 n = 0; n < length; n++) { r[n * stride] = lineReal[n]; i[n * stride] = lineImag[n]; }
+    }
+}
+
+/*
+    PrimeFactorDFT2D on 1155 x 102 and PrimeFactorDFT3D on 30 x 77 x 34
+    points, both large enough to split the lines over the pool, against the
+    1D transforms of the gathered lines of every axis. Forward and inverse, on no workers and on
+    three. The error relative to the largest output must stay under 1e-13,
+    a scaled round trip under 1e-13. Returns the number of failures.
+*/
+int test21MultiDimDFT()
+{
+    static const factorSeq shapes[][3] = {
+        { { 3, 5, 7, 11 }, { 2, 3, 17 }, {} },
+        { { 2, 3, 5 }, { 7, 11 }, { 2, 17 } } };
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    int failed = 0;
+
+    std::cout << "Test21MultiDimDFT begin " << std::endl;
+    for (int workers = 0; workers <= 3; workers += 3)
+    for (std::size_t shape = 0; shape < sizeof(shapes) / sizeof(shapes[0]); shape++)
+    {
+        ThreadPool pool(workers);
+        factorSeq axisFactors[3] = { shapes[shape][0], shapes[shape][1], shapes[shape][2] };
+        int dims = axisFactors[2].empty() ? 2 : 3;
+
+        PrimeFactorDFT2D plan2D;
+        PrimeFactorDFT3D plan3D;
+        MultiDimDFT* plan = (dims == 2) ? (MultiDimDFT*)&plan2D : (MultiDimDFT*)&plan3D;
+        plan->SetPool(&pool);
+        s64 size = (dims == 2) ? plan2D.SetFactors(axisFactors[0], axisFactors[1])
+            : plan3D.SetFactors(axisFactors[0], axisFactors[1], axisFactors[2]);
+
+        PrimeFactorDFT lines[3];
+        s64 expectedSize = 1;
+        for (int a = 0; a < dims; a++) {
+            lines[a].SetFactors(axisFactors[a]);
+            expectedSize *= lines[a].Status();
+        }
+        bool ok = size == expectedSize && plan->Status() == size;
+
+        std::ostringstream name;
+        for (int a = 0; a < dims; a++) name << (a ? " x " : "") << lines[a].Status();
+
+        if (ok) {
+            DataBuffer real(size), imag(size), input(2 * size), expected(2 * size);
+            Data worst = 0;
+            for (int direction = 0; direction < 2; direction++)
+            {
+                for (s64 i = 0; i < size; i++) {
+                    input[i] = expected[i] = real[i] = dist(mt);
+                    input[size + i] = expected[size + i] = imag[i] = dist(mt);
+                }
+                s64 stride = size;
+                for (int a = 0; a < dims; a++) {
+                    stride /= lines[a].Status();
+                    AxisLines(lines[a], expected, expected + size, size, stride, direction);
+                }
+                if (direction == 0) plan->forwardFFT(real, imag);
+                else plan->InverseFFT(real, imag);
+
+                Data largest = 0, error = 0;
+                for (s64 i = 0; i < size; i++) {
+                    largest = std::max(largest, std::fabs(expected[i]) + std::fabs(expected[size + i]));
+                    error = std::max(error, std::fabs(real[i] - expected[i]) + std::fabs(imag[i] - expected[size + i]));
+                }
+                worst = std::max(worst, error / largest);
+            }
+
+            for (s64 i = 0; i < size; i++) {
+                input[i] = real[i] = dist(mt);
+                input[size + i] = imag[i] = dist(mt);
+            }
+            plan->forwardFFT(real, imag);
+            plan->ScaledInverseFFT(real, imag);
+            Data roundTrip = 0;
+            for (s64 i = 0; i < size; i++)
+                roundTrip = std::max(roundTrip, std::fabs(real[i] - input[i]) + std::fabs(imag[i] - input[size + i]));
+
+            ok = worst < 1e-13 && roundTrip < 1e-13;
+            name << " error " << worst << " round trip " << roundTrip;
+        }
+        std::cout << name.str() << ", " << workers << " workers" << (ok ? "" : "  FAILED") << std::endl;
+        if (!ok) failed++;
+    }
+    std::cout << "Test21MultiDimDFT end " << std::endl << std::endl;
+    return failed;
+}
+
+/*
+    Pruned transforms that keep part of the output, against the same bins of
+    the full transform: a window inside the output and one that wraps past
+    the end, with input all over and input on a window that also wraps.
+    Forward and inverse. A few bins of the output must run fewer butterflies
+    than the full transform, a contiguous window touches most butterflies of
+    every stage, and the bins kept must be within 1e-13 of the
+    full transform relative to its largest bin. Returns the number of failures.
+*/
+int test22PrunedOutput()
+{
+    /* input start and length in N / 16, output start in N / 16 and length in bins */
+    static const s64 windows[][4] = { { 0, 16, 3, 6 }, { 0, 16, 15, 90 }, { 0, 5, 15, 90 }, { 14, 4, 6, 1 }, { 13, 6, 0, 40 } };
+    static const factorSeq sets[] = { { 3, 5, 7, 11 }, { 2, 3, 5, 7, 17 } };
+    std::uniform_real_distribution<Data> dist(-1.0, 1.0);
+    int failed = 0;
+
+    std::cout << "Test22PrunedOutput begin " << std::endl;
+    for (std::size_t set = 0; set < sizeof(sets) / sizeof(sets[0]); set++)
+    {
+        factorSeq factors = sets[set];
+        PrimeFactorDFT pf;
+        pf.SetFactors(factors);
+        s64 N = pf.Status();
+        DataBuffer real(N), imag(N), fullReal(N), fullImag(N);
+
+        for (std::size_t w = 0; w < sizeof(windows) / sizeof(windows[0]); w++)
+        for (int inverse = 0; inverse < 2; inverse++)
+        {
+            s64 inStart = windows[w][0] * N / 16, inLength = windows[w][1] * N / 16;
+            s64 outStart = windows[w][2] * N / 16, outLength = windows[w][3];
+            if (windows[w][1] == 16) inLength = N;
+            /* the last window ends past N */
+            if (outStart == 0) outStart = N - outLength / 2;
+
+            PrunedStages pruned;
+            bool ok = pf.Prune(inStart, inLength, outStart, outLength, pruned) > 0 && pruned.Work() < 1.0;
+
+            for (s64 i = 0; i < N; i++) fullReal[i] = fullImag[i] = 0;
+            for (s64 i = 0; i < inLength; i++) {
+                s64 n = (inStart + i) % N;
+                fullReal[n] = dist(mt);
+                fullImag[n] = dist(mt);
+            }
+            for (s64 i = 0; i < N; i++) { real[i] = fullReal[i]; imag[i] = fullImag[i]; }
+
+            if (inverse) {
+                pf.InverseFFT(fullReal, fullImag);
+                pf.InverseFFT(real, imag, pruned);
+            }
+            else {
+                pf.forwardFFT(fullReal, fullImag);
+                pf.forwardFFT(real, imag, pruned);
+            }
+
+            Data largest = 0, error = 0;
+            for (s64 i = 0; i < N; i++)
+                largest = std::max(largest, std::fabs(fullReal[i]) + std::fabs(fullImag[i]));
+            for (s64 i = 0; i < outLength; i++) {
+                s64 k = (outStart + i) % N;
+                error = std::max(error, std::fabs(real[k] - fullReal[k]) + std::fabs(imag[k] - fullImag[k]));
+            }
+            ok = ok && error <= 1e-13 * largest;
+
+            std::cout << "N " << N << (inverse ? " inverse" : " forward") << " in " << inStart << "+" << inLength
+                << " out " << outStart << "+" << outLength << " work " << pruned.Work() << " error " << error
+                << (ok ? "" : "  FAILED") << std::endl;
+            if (!ok) failed++;
+        }
+    }
+    std::cout << "Test22PrunedOutput end " << std::endl << std::endl;
+    return failed;
+}
+
+/*
+    With the argument "accuracy" only the accuracy test runs, an optional
+    second argument is the longest length tested. The roofline measures the
+    machine with large buffers, so it only runs with "roofline".
+    Returns the number of failures.
+*/
+int main(int argc, char* argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "accuracy") == 0)
+        return testAccuracy((argc > 2) ? atoll(argv[2]) : LIMIT);
+    if (argc > 1 && strcmp(argv[1], "roofline") == 0) {
+        testRoofline();
+        return 0;
+    }
+
     test1();
     test2DNA();
     test3Convolution();
     test4();
+    int failed = test5Peaks();
+    failed += test6NTT();
+    failed += test7BigMultiply();
+    failed += test8StreamFilter();
+    failed += test9SequenceMatcher();
+    failed += test10Layout();
+    failed += test11PartialDFT();
+    failed += test12STFT();
+    failed += test13SlidingDFT();
+    failed += test14TrigTransform();
+    failed += test15OutOfCoreDFT();
+    failed += test16StageProfiler();
+    failed += test17ThreadPool();
+    failed += test18Async();
+    failed += test19Pipeline();
+    failed += test20SharedMemoryDFT();
+    failed += test21MultiDimDFT();
+    failed += test22PrunedOutput();
+    failed += testAccuracy(LIMIT);
     std::cout << "Done !\n";
+    return failed;
 }
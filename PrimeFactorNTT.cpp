@@ -0,0 +1,518 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+*/
+
+#include "PrimeFactorNTT.h"
+
+u64 PowMod(u64 a, u64 e, u64 q)
+{
+    u64 r = 1;
+    a %= q;
+    while (e) {
+        if (e & 1) r = MulMod(r, a, q);
+        a = MulMod(a, a, q);
+        e >>= 1;
+    }
+    return r;
+}
+
+/*
+    Miller-Rabin, the bases are sufficient for all n < 3.3 * 10^24
+*/
+static bool IsPrime(u64 n)
+{
+    static const u64 bases[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+
+    if (n < 2) return false;
+    for (std::size_t i = 0; i < sizeof(bases) / sizeof(bases[0]); i++) {
+        if (n == bases[i]) return true;
+        if (n % bases[i] == 0) return false;
+    }
+
+    u64 d = n - 1;
+    int r = 0;
+    while ((d & 1) == 0) { d >>= 1; r++; }
+
+    for (std::size_t i = 0; i < sizeof(bases) / sizeof(bases[0]); i++) {
+        u64 x = PowMod(bases[i], d, n);
+        if (x == 1 || x == n - 1) continue;
+        bool composite = true;
+        for (int j = 1; j < r; j++) {
+            x = MulMod(x, x, n);
+            if (x == n - 1) { composite = false; break; }
+        }
+        if (composite) return false;
+    }
+    return true;
+}
+
+void PrimeFactorNTT::SetFactors(factorSeq& _factors, int primeCount)
+{
+    factors = _factors;
+    state = ValidateFactors(factors);
+    CleanUpNTT();
+    if (state > 0) {
+        InitRotations();
+        FindPrimes(primeCount);
+        InitNTT(factors);
+    }
+}
+
+void PrimeFactorNTT::FindPrimes(int primeCount)
+{
+    primes.clear();
+    scale.clear();
+    garner.clear();
+
+    const u64 limit = ((u64)1) << 62;
+    u64 k = (limit - 1) / state;
+
+    while ((int)primes.size() < primeCount && k > 0) {
+        u64 q = k * state + 1;
+        if (IsPrime(q)) primes.push_back(q);
+        k--;
+    }
+
+    for (std::size_t i = 0; i < primes.size(); i++) {
+        /* N^-1 = N^(q-2) */
+        scale.push_back(PowMod(state % primes[i], primes[i] - 2, primes[i]));
+        std::vector<u64> inv;
+        for (std::size_t j = 0; j < i; j++)
+            inv.push_back(PowMod(primes[j] % primes[i], primes[i] - 2, primes[i]));
+        garner.push_back(inv);
+    }
+}
+
+/*
+    An element of order exactly N: a^((q-1)/N) for the first a where
+    no (N/f)-th power is 1, f running through the factors.
+*/
+u64 PrimeFactorNTT::FindRoot(u64 q)
+{
+    for (u64 a = 2; a < q; a++) {
+        u64 w = PowMod(a, (q - 1) / state, q);
+        bool primitive = true;
+        for (factorSeq::const_iterator cit = factors.begin(); cit != factors.end(); cit++)
+            if (PowMod(w, state / *cit, q) == 1) { primitive = false; break; }
+        if (primitive) return w;
+    }
+    return 0;
+}
+
+void PrimeFactorNTT::InitNTT(factorSeq& _factors)
+{
+    for (std::size_t pr = 0; pr < primes.size(); pr++)
+    {
+        u64 q = primes[pr];
+        u64 w = FindRoot(q);
+        std::vector<BasicNTT*> stages;
+
+        for (std::size_t i = 0; i < _factors.size(); i++)
+        {
+            std::vector<s64>  indices;
+            InitIndices(indices, _factors[i], state);
+            /* the p-th root of unity of this stage */
+            u64 root = PowMod(w, state / _factors[i], q);
+            BasicNTT* t;
+            switch (_factors[i])
+            {
+            case 2:  t = (BasicNTT*) new NTT2(Rotations[i], state / 2, indices, q); 	stages.push_back(t); break;
+            case 3:  t = (BasicNTT*) new NTT3(Rotations[i], state / 3, indices, q, root); 	stages.push_back(t); break;
+            case 5:  t = (BasicNTT*) new NTT5(Rotations[i], state / 5, indices, q, root); 	stages.push_back(t); break;
+            case 7:  t = (BasicNTT*) new NTT7(Rotations[i], state / 7, indices, q, root); 	stages.push_back(t); break;
+            case 11: t = (BasicNTT*) new NTTModule<11>(Rotations[i], state / 11, indices, q, root); 	stages.push_back(t); break;
+            case 13: t = (BasicNTT*) new NTTModule<13>(Rotations[i], state / 13, indices, q, root); 	stages.push_back(t); break;
+            case 17: t = (BasicNTT*) new NTTModule<17>(Rotations[i], state / 17, indices, q, root); 	stages.push_back(t); break;
+            case 19: t = (BasicNTT*) new NTTModule<19>(Rotations[i], state / 19, indices, q, root); 	stages.push_back(t); break;
+            case 31: t = (BasicNTT*) new NTTModule<31>(Rotations[i], state / 31, indices, q, root); 	stages.push_back(t); break;
+            default: t = 0; break;
+            }
+            if (0 == t) {
+                /* ValidateFactors lets no other factor through; fail the plan rather than leave a stage out */
+                while (stages.size()) {
+                    delete stages.back();
+                    stages.pop_back();
+                }
+                CleanUpNTT();
+                state = -1;
+                return;
+            }
+        }
+        NTTs.push_back(stages);
+    }
+}
+
+void PrimeFactorNTT::CleanUpNTT()
+{
+    while (NTTs.size()) {
+        while (NTTs.back().size()) {
+            delete NTTs.back().back();
+            NTTs.back().pop_back();
+        }
+        NTTs.pop_back();
+    }
+}
+
+void PrimeFactorNTT::forwardNTT(u64* data, int prime)
+{
+    for (std::vector<BasicNTT*>::const_iterator it = NTTs[prime].begin(); it != NTTs[prime].end(); it++)
+    {
+        (*it)->Evaluate(data);
+    }
+}
+
+/*
+    The inverse transform is the forward one read backwards:
+    x[n] = 1/N * X'[-n mod N], where X' is the forward transform of X.
+*/
+void PrimeFactorNTT::InverseNTT(u64* data, int prime)
+{
+    u64 q = primes[prime];
+    u64 s = scale[prime];
+    u64 sp = ShoupPrecompute(s, q);
+
+    forwardNTT(data, prime);
+
+    data[0] = ShoupMulMod(data[0], s, sp, q);
+    for (s64 i = 1, j = state - 1; i <= j; i++, j--)
+    {
+        u64 t = ShoupMulMod(data[i], s, sp, q);
+        data[i] = ShoupMulMod(data[j], s, sp, q);
+        data[j] = t;
+    }
+}
+
+void PrimeFactorNTT::Multiply(u64* a, const u64* b, int prime)
+{
+    u64 q = primes[prime];
+    for (s64 i = 0; i < state; i++)
+        a[i] = MulMod(a[i], b[i], q);
+}
+
+/*
+    Garner's algorithm: the mixed radix digits v[i] < primes[i] of the value,
+    then Horner's rule in multi precision.
+*/
+void PrimeFactorNTT::CRT(u64* const* residues, s64 i, u64* value)
+{
+    std::size_t m = primes.size();
+    std::vector<u64> v(m);
+
+    for (std::size_t k = 0; k < m; k++) {
+        u64 q = primes[k];
+        u64 t = residues[k][i];
+        for (std::size_t j = 0; j < k; j++)
+            t = MulMod(SubMod(t, v[j] % q, q), garner[k][j], q);
+        v[k] = t;
+    }
+
+    for (std::size_t k = 0; k < m; k++) value[k] = 0;
+    value[0] = v[m - 1];
+    for (std::size_t k = m - 1; k-- > 0;) {
+        /* value = value * primes[k] + v[k] */
+        u64 carry = v[k];
+        for (std::size_t l = 0; l < m; l++) {
+            u64 hi = MulHi(value[l], primes[k]);
+            u64 lo = value[l] * primes[k];
+            lo += carry;
+            hi += (lo < carry) ? 1 : 0;
+            value[l] = lo;
+            carry = hi;
+        }
+    }
+}
+
+void NTT2::Evaluate(u64* data)
+{
+    std::vector<s64> ind = indices;
+
+    for (s64 i = 0; i < count; i++)
+    {
+        u64 t1 = AddMod(data[ind[0]], data[ind[1]], q);
+        u64 t2 = SubMod(data[ind[0]], data[ind[1]], q);
+        data[ind[0]] = t1;
+        data[ind[1]] = t2;
+        //
+        //  CRT mapping.
+        //
+        IncIndices(ind);
+    }
+}
+
+/*
+    c[j] = (w^j + w^-j)/2 and s[j] = (w^j - w^-j)/2, j = 0..P-1,
+    for the rotated root w = Root^Rotation.
+*/
+static void HalfSums(int Rotation, u64 Root, unsigned int P, u64 q, u64* c, u64* s)
+{
+    int r = Rotation % (int)P;
+    if (r < 0) r += P;
+
+    u64 w[31];
+    u64 wr = PowMod(Root, r, q);
+    w[0] = 1;
+    for (unsigned int k = 1; k < P; k++) w[k] = MulMod(w[k - 1], wr, q);
+
+    u64 half = (q + 1) / 2;
+    for (unsigned int j = 0; j < P; j++) {
+        u64 plus = w[j];
+        u64 minus = w[(P - j) % P];
+        c[j] = MulMod(AddMod(plus, minus, q), half, q);
+        s[j] = MulMod(SubMod(plus, minus, q), half, q);
+    }
+}
+
+NTT3::NTT3(int  Rotation, s64 Count, std::vector<s64> startIndices, u64 Prime, u64 Root)
+{
+    count = Count;
+    indices = startIndices;
+    q = Prime;
+
+    u64 c[3], s[3];
+    HalfSums(Rotation, Root, 3, q, c, s);
+    u[0] = SubMod(c[1], 1, q);
+    u[1] = s[1];
+    for (int i = 0; i < 2; i++) up[i] = ShoupPrecompute(u[i], q);
+}
+
+void NTT3::Evaluate(u64* data)
+{
+    std::vector<s64> ind = indices;
+
+    for (s64 i = 0; i < count; i++)
+    {
+        u64 x0 = data[ind[0]];
+        u64 a = AddMod(data[ind[1]], data[ind[2]], q);
+        u64 b = SubMod(data[ind[1]], data[ind[2]], q);
+
+        u64 y0 = AddMod(x0, a, q);
+        u64 A = AddMod(y0, ShoupMulMod(a, u[0], up[0], q), q);
+        u64 B = ShoupMulMod(b, u[1], up[1], q);
+
+        data[ind[0]] = y0;
+        data[ind[1]] = AddMod(A, B, q);
+        data[ind[2]] = SubMod(A, B, q);
+        //
+        //  CRT mapping.
+        //
+        IncIndices(ind);
+    }
+}
+
+NTT5::NTT5(int  Rotation, s64 Count, std::vector<s64> startIndices, u64 Prime, u64 Root)
+{
+    count = Count;
+    indices = startIndices;
+    q = Prime;
+
+    u64 c[5], s[5];
+    HalfSums(Rotation, Root, 5, q, c, s);
+    u64 half = (q + 1) / 2;
+    /* A1,2 = x0 + (c1 + c2)/2 (a1 + a2) +- (c1 - c2)/2 (a1 - a2) */
+    u[0] = SubMod(MulMod(AddMod(c[1], c[2], q), half, q), 1, q);
+    u[1] = MulMod(SubMod(c[1], c[2], q), half, q);
+    /* B1 = s1 b1 + s2 b2, B2 = s2 b1 - s1 b2 */
+    u[2] = s[2];
+    u[3] = SubMod(s[1], s[2], q);
+    u[4] = AddMod(s[1], s[2], q);
+    for (int i = 0; i < 5; i++) up[i] = ShoupPrecompute(u[i], q);
+}
+
+void NTT5::Evaluate(u64* data)
+{
+    std::vector<s64> ind = indices;
+
+    for (s64 i = 0; i < count; i++)
+    {
+        u64 x0 = data[ind[0]];
+        u64 a1 = AddMod(data[ind[1]], data[ind[4]], q);
+        u64 b1 = SubMod(data[ind[1]], data[ind[4]], q);
+        u64 a2 = AddMod(data[ind[2]], data[ind[3]], q);
+        u64 b2 = SubMod(data[ind[2]], data[ind[3]], q);
+
+        u64 t1 = AddMod(a1, a2, q);
+        u64 t2 = SubMod(a1, a2, q);
+        u64 y0 = AddMod(x0, t1, q);
+
+        u64 m1 = AddMod(y0, ShoupMulMod(t1, u[0], up[0], q), q);
+        u64 m2 = ShoupMulMod(t2, u[1], up[1], q);
+        u64 A1 = AddMod(m1, m2, q);
+        u64 A2 = SubMod(m1, m2, q);
+
+        u64 m3 = ShoupMulMod(AddMod(b1, b2, q), u[2], up[2], q);
+        u64 B1 = AddMod(m3, ShoupMulMod(b1, u[3], up[3], q), q);
+        u64 B2 = SubMod(m3, ShoupMulMod(b2, u[4], up[4], q), q);
+
+        data[ind[0]] = y0;
+        data[ind[1]] = AddMod(A1, B1, q);
+        data[ind[4]] = SubMod(A1, B1, q);
+        data[ind[2]] = AddMod(A2, B2, q);
+        data[ind[3]] = SubMod(A2, B2, q);
+        //
+        //  CRT mapping.
+        //
+        IncIndices(ind);
+    }
+}
+
+/*
+    With K = (k1, k2, k4) = kappa + (d1, d2, d4), d1 + d2 + d4 = 0, the
+    convolution R_j = sum K_{jn} v_n over j, n in {1, 2, 4} is
+
+        R1 = kappa T + d1 e1 + d2 e2
+        R2 = kappa T + (d1 + d2)(e1 - e2) - d1 e1
+        R4 = kappa T - d2 e2 - (d1 + d2)(e1 - e2)
+
+    where T = v1 + v2 + v4, e1 = v1 - v4 and e2 = v2 - v4. The sum half has
+    K = (c1, c2, c3), v = (a1, a2, a3); the difference half K = (s1, s2, -s3),
+    v = (b1, b2, -b3), and B3 = -B4.
+*/
+NTT7::NTT7(int  Rotation, s64 Count, std::vector<s64> startIndices, u64 Prime, u64 Root)
+{
+    count = Count;
+    indices = startIndices;
+    q = Prime;
+
+    u64 c[7], s[7];
+    HalfSums(Rotation, Root, 7, q, c, s);
+    u64 third = PowMod(3, q - 2, q);
+
+    u64 kappa = MulMod(AddMod(AddMod(c[1], c[2], q), c[3], q), third, q);
+    u[0] = SubMod(kappa, 1, q);
+    u[1] = SubMod(c[1], kappa, q);
+    u[2] = SubMod(c[2], kappa, q);
+    u[3] = AddMod(u[1], u[2], q);
+
+    u64 sigma = MulMod(SubMod(AddMod(s[1], s[2], q), s[3], q), third, q);
+    u[4] = sigma;
+    u[5] = SubMod(s[1], sigma, q);
+    u[6] = SubMod(s[2], sigma, q);
+    u[7] = AddMod(u[5], u[6], q);
+    for (int i = 0; i < 8; i++) up[i] = ShoupPrecompute(u[i], q);
+}
+
+void NTT7::Evaluate(u64* data)
+{
+    std::vector<s64> ind = indices;
+
+    for (s64 i = 0; i < count; i++)
+    {
+        u64 x0 = data[ind[0]];
+        u64 a1 = AddMod(data[ind[1]], data[ind[6]], q);
+        u64 b1 = SubMod(data[ind[1]], data[ind[6]], q);
+        u64 a2 = AddMod(data[ind[2]], data[ind[5]], q);
+        u64 b2 = SubMod(data[ind[2]], data[ind[5]], q);
+        u64 a3 = AddMod(data[ind[3]], data[ind[4]], q);
+        u64 b3 = SubMod(data[ind[3]], data[ind[4]], q);
+
+        u64 T = AddMod(AddMod(a1, a2, q), a3, q);
+        u64 y0 = AddMod(x0, T, q);
+        u64 base = AddMod(y0, ShoupMulMod(T, u[0], up[0], q), q);
+        u64 e1 = SubMod(a1, a3, q);
+        u64 e2 = SubMod(a2, a3, q);
+        u64 ma = ShoupMulMod(e1, u[1], up[1], q);
+        u64 mb = ShoupMulMod(e2, u[2], up[2], q);
+        u64 mc = ShoupMulMod(SubMod(e1, e2, q), u[3], up[3], q);
+        u64 A1 = AddMod(base, AddMod(ma, mb, q), q);
+        u64 A2 = AddMod(base, SubMod(mc, ma, q), q);
+        u64 A4 = SubMod(base, AddMod(mb, mc, q), q);
+
+        u64 Tb = SubMod(AddMod(b1, b2, q), b3, q);
+        u64 ms = ShoupMulMod(Tb, u[4], up[4], q);
+        u64 g1 = AddMod(b1, b3, q);
+        u64 g2 = AddMod(b2, b3, q);
+        u64 na = ShoupMulMod(g1, u[5], up[5], q);
+        u64 nb = ShoupMulMod(g2, u[6], up[6], q);
+        u64 nc = ShoupMulMod(SubMod(g1, g2, q), u[7], up[7], q);
+        u64 B1 = AddMod(ms, AddMod(na, nb, q), q);
+        u64 B2 = AddMod(ms, SubMod(nc, na, q), q);
+        u64 B4 = SubMod(ms, AddMod(nb, nc, q), q);
+
+        data[ind[0]] = y0;
+        data[ind[1]] = AddMod(A1, B1, q);
+        data[ind[6]] = SubMod(A1, B1, q);
+        data[ind[2]] = AddMod(A2, B2, q);
+        data[ind[5]] = SubMod(A2, B2, q);
+        data[ind[4]] = AddMod(A4, B4, q);
+        data[ind[3]] = SubMod(A4, B4, q);
+        //
+        //  CRT mapping.
+        //
+        IncIndices(ind);
+    }
+}
+
+template <unsigned int P>
+NTTModule<P>::NTTModule(int  Rotation, s64 Count, std::vector<s64> startIndices, u64 Prime, u64 Root)
+{
+    count = Count;
+    indices = startIndices;
+    q = Prime;
+
+    int r = Rotation % (int)P;
+    if (r < 0) r += P;
+
+    /* powers of the rotated root w = Root^r */
+    u64 w[P];
+    u64 wr = PowMod(Root, r, q);
+    w[0] = 1;
+    for (unsigned int k = 1; k < P; k++) w[k] = MulMod(w[k - 1], wr, q);
+
+    u64 half = (q + 1) / 2;
+    for (unsigned int k = 1; k <= H; k++)
+        for (unsigned int n = 1; n <= H; n++)
+        {
+            u64 plus = w[(n * k) % P];
+            u64 minus = w[P - (n * k) % P];
+            c[k - 1][n - 1] = MulMod(AddMod(plus, minus, q), half, q);
+            s[k - 1][n - 1] = MulMod(SubMod(plus, minus, q), half, q);
+            cp[k - 1][n - 1] = ShoupPrecompute(c[k - 1][n - 1], q);
+            sp[k - 1][n - 1] = ShoupPrecompute(s[k - 1][n - 1], q);
+        }
+}
+
+template <unsigned int P>
+void NTTModule<P>::Evaluate(u64* data)
+{
+    u64 x[P];
+    u64 a[H];
+    u64 b[H];
+
+    std::vector<s64> ind = indices;
+
+    for (s64 i = 0; i < count; i++)
+    {
+        for (unsigned int px = 0; px < P; px++)
+            x[px] = data[ind[px]];
+
+        u64 y0 = x[0];
+        for (unsigned int n = 1; n <= H; n++) {
+            a[n - 1] = AddMod(x[n], x[P - n], q);
+            b[n - 1] = SubMod(x[n], x[P - n], q);
+            y0 = AddMod(y0, a[n - 1], q);
+        }
+        data[ind[0]] = y0;
+
+        for (unsigned int k = 0; k < H; k++) {
+            u64 A = x[0];
+            u64 B = 0;
+            for (unsigned int n = 0; n < H; n++) {
+                A = AddMod(A, ShoupMulMod(a[n], c[k][n], cp[k][n], q), q);
+                B = AddMod(B, ShoupMulMod(b[n], s[k][n], sp[k][n], q), q);
+            }
+            data[ind[k + 1]] = AddMod(A, B, q);
+            data[ind[P - 1 - k]] = SubMod(A, B, q);
+        }
+
+        //
+        //  CRT mapping.
+        //
+        IncIndices(ind);
+    }
+}
@@ -0,0 +1,229 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+	The number theoretic counterpart of PrimeFactorDFT.
+
+	The prime factor algorithm has no twiddle factors between the stages, so the
+	same rotations, start indices and CRT index walk carry over unchanged to
+	arithmetic modulo a prime q with q == 1 (mod N). The modules compute the
+	length p transform directly, pairing the points n and p-n, using the
+	p-th root of unity raised to the rotation of the factor.
+
+	NTT3, NTT5 and NTT7 are short modules in the Winograd form of DFT3, DFT5
+	and DFT7, with 2, 5 and 8 constant multiplications per butterfly. The
+	factors 11 to 31 use the generic kernel NTTModule<P>, which costs
+	2 * ((P - 1) / 2)^2 multiplications: 50 for 11, 72 for 13, 128 for 17,
+	162 for 19 and 450 for 31, growing with P^2 where the Winograd modules
+	grow about linearly. The large factors are where the time goes.
+*/
+#include "PrimeFactorDFT.h"
+
+#ifdef WIN
+#include <intrin.h>
+#endif
+
+/*
+*  Arithmetic modulo q, q < 2^62, operands in [0, q).
+*/
+inline u64 AddMod(u64 a, u64 b, u64 q)
+{
+	u64 r = a + b;
+	return (r >= q) ? r - q : r;
+}
+
+inline u64 SubMod(u64 a, u64 b, u64 q)
+{
+	return (a >= b) ? a - b : a + q - b;
+}
+
+inline u64 MulHi(u64 a, u64 b)
+{
+#ifdef WIN
+	return __umulh(a, b);
+#endif
+#ifdef NOTWIN
+	return (u64)(((unsigned __int128)a * b) >> 64);
+#endif
+}
+
+inline u64 MulMod(u64 a, u64 b, u64 q)
+{
+#ifdef WIN
+	u64 hi;
+	u64 lo = _umul128(a, b, &hi);
+	u64 rem;
+	_udiv128(hi, lo, q, &rem);
+	return rem;
+#endif
+#ifdef NOTWIN
+	return (u64)(((unsigned __int128)a * b) % q);
+#endif
+}
+
+/*
+*  Shoup's multiplication by a constant w: wp = floor(w * 2^64 / q) is computed
+*  once, after which x * w mod q costs two multiplications and no division.
+*/
+inline u64 ShoupPrecompute(u64 w, u64 q)
+{
+#ifdef WIN
+	u64 rem;
+	return _udiv128(w, 0, q, &rem);
+#endif
+#ifdef NOTWIN
+	return (u64)(((unsigned __int128)w << 64) / q);
+#endif
+}
+
+inline u64 ShoupMulMod(u64 x, u64 w, u64 wp, u64 q)
+{
+	u64 r = x * w - MulHi(x, wp) * q;
+	return (r >= q) ? r - q : r;
+}
+
+u64 PowMod(u64 a, u64 e, u64 q);
+
+
+class BasicNTT : protected CRTIndices {
+
+public:
+	BasicNTT() {};
+	virtual ~BasicNTT() { indices.clear(); }
+	virtual void Evaluate(u64* data) = 0;
+
+};
+
+class NTT2 : protected BasicNTT {
+public:
+	NTT2(int  Rotation, s64 Count, std::vector<s64> startIndices, u64 Prime)
+	{
+		count = Count;
+		(void)Rotation;
+		indices = startIndices;
+		q = Prime;
+	};
+	~NTT2() { indices.clear(); }
+	void Evaluate(u64* data);
+private:
+	u64 q;
+};
+
+/*
+*  Short modules. The constants are the halved sums and differences of the
+*  rotated root's powers, c_j = (w^j + w^-j)/2 and s_j = (w^j - w^-j)/2,
+*  combined as in the DFTn modules, with their Shoup companions in up.
+*/
+class NTT3 : protected BasicNTT {
+public:
+	NTT3(int  Rotation, s64 Count, std::vector<s64> startIndices, u64 Prime, u64 Root);
+	~NTT3() { indices.clear(); }
+	void Evaluate(u64* data);
+private:
+	u64 q;
+	u64 u[2];
+	u64 up[2];
+};
+
+class NTT5 : protected BasicNTT {
+public:
+	NTT5(int  Rotation, s64 Count, std::vector<s64> startIndices, u64 Prime, u64 Root);
+	~NTT5() { indices.clear(); }
+	void Evaluate(u64* data);
+private:
+	u64 q;
+	u64 u[5];
+	u64 up[5];
+};
+
+/*
+*  The residues {1, 2, 4} are closed under multiplication modulo 7, so the
+*  sum and the difference halves are each a length 3 cyclic convolution,
+*  done in 4 multiplications.
+*/
+class NTT7 : protected BasicNTT {
+public:
+	NTT7(int  Rotation, s64 Count, std::vector<s64> startIndices, u64 Prime, u64 Root);
+	~NTT7() { indices.clear(); }
+	void Evaluate(u64* data);
+private:
+	u64 q;
+	u64 u[8];
+	u64 up[8];
+};
+
+/*
+*  Length P module, P odd. Root is a primitive P-th root of unity modulo Prime.
+*/
+template <unsigned int P>
+class NTTModule : protected BasicNTT {
+public:
+	NTTModule(int  Rotation, s64 Count, std::vector<s64> startIndices, u64 Prime, u64 Root);
+	~NTTModule() { indices.clear(); }
+	void Evaluate(u64* data);
+private:
+	enum { H = (P - 1) / 2 };
+
+	u64 q;
+	/* (w^nk + w^-nk)/2 and (w^nk - w^-nk)/2 for n, k = 1..H, with their Shoup companions */
+	u64 c[H][H];
+	u64 cp[H][H];
+	u64 s[H][H];
+	u64 sp[H][H];
+};
+
+
+class PrimeFactorNTT : public PrimeFactorPlan
+{
+public:
+
+	PrimeFactorNTT() {};
+	~PrimeFactorNTT() { CleanUpNTT(); };
+
+	/*
+	*  Sets up the transform for primeCount primes q == 1 (mod length), the
+	*  largest ones below 2^62. Status() as for PrimeFactorDFT.
+	*/
+	void SetFactors(factorSeq& _factors, int primeCount = 1);
+
+	int PrimeCount() { return (int)primes.size(); };
+	u64 Prime(int prime) { return primes[prime]; };
+
+	/*
+	*  In place transforms of residues modulo Prime(prime), entries in [0, q).
+	*  forwardNTT uses the root of unity w, InverseNTT w^-1 and the scaling 1/N,
+	*  so InverseNTT(forwardNTT(a)) == a.
+	*/
+	void forwardNTT(u64* data, int prime = 0);
+	void InverseNTT(u64* data, int prime = 0);
+
+	/*
+	*  a[i] = a[i] * b[i]  mod Prime(prime)
+	*/
+	void Multiply(u64* a, const u64* b, int prime = 0);
+
+	/*
+	*  Chinese remaindering of entry i of the PrimeCount() residue arrays
+	*  residues[0..PrimeCount()-1] into PrimeCount() 64 bit limbs, least
+	*  significant first. The result is in [0, product of the primes).
+	*/
+	void CRT(u64* const* residues, s64 i, u64* value);
+
+private:
+	void FindPrimes(int primeCount);
+	u64 FindRoot(u64 q);
+	void InitNTT(factorSeq& _factors);
+	void CleanUpNTT();
+
+	std::vector<u64> primes;
+	std::vector<u64> scale;
+	/* garner[i][j] = primes[j]^-1 mod primes[i], j < i */
+	std::vector< std::vector<u64> > garner;
+	std::vector< std::vector<BasicNTT*> > NTTs;
+};
@@ -0,0 +1,109 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+*/
+
+#include <cmath>
+#include "STFT.h"
+
+/* transforms per batch, each with two frames */
+#define PAIRS 4
+
+/* below this many samples of frames the calling thread does it all */
+#define THREADLIMIT  (1 << 16)
+
+s64 STFT::SetFrame(factorSeq& factors, s64 _hop)
+{
+    pf.SetFactors(factors);
+    length = pf.Status();
+    if (length <= 0) return length;
+
+    hop = (_hop > 0) ? _hop : 1;
+    pf.SetLayout(1, PAIRS, length);
+
+    window.resize(length);
+    for (s64 i = 0; i < length; i++)
+        window[i] = (Data)(0.5L - 0.5L * std::cos(2.0L * 3.141592653589793238462643383279503L * i / length));
+    return length;
+}
+
+void STFT::SetWindow(const Data* _window)
+{
+    for (s64 i = 0; i < length; i++) window[i] = _window[i];
+}
+
+/*
+    With frame a in the real part and b in the imaginary part, Z = A + iB and
+        A[k] = (Z[k] + conj(Z[-k])) / 2,   B[k] = (Z[k] - conj(Z[-k])) / 2i
+*/
+void STFT::Groups(STFT* stft, const Data* signal, s64 frames, s64 first, s64 last, Data* out, int output)
+{
+    s64 N = stft->length;
+    s64 bins = stft->Bins();
+    const Data* w = stft->window.data();
+    std::vector<Data> real(PAIRS * N);
+    std::vector<Data> imag(PAIRS * N);
+
+    for (s64 g = first; g < last; g++)
+    {
+        s64 f0 = g * 2 * PAIRS;
+        for (int p = 0; p < PAIRS; p++) {
+            Data* r = real.data() + p * N;
+            Data* i = imag.data() + p * N;
+            s64 fa = f0 + 2 * p;
+            s64 fb = fa + 1;
+            for (s64 n = 0; n < N; n++) {
+                r[n] = (fa < frames) ? w[n] * signal[fa * stft->hop + n] : 0;
+                i[n] = (fb < frames) ? w[n] * signal[fb * stft->hop + n] : 0;
+            }
+        }
+
+        stft->pf.forwardFFT(real.data(), imag.data());
+
+        for (int p = 0; p < PAIRS; p++) {
+            const Data* r = real.data() + p * N;
+            const Data* i = imag.data() + p * N;
+            s64 fa = f0 + 2 * p;
+            s64 fb = fa + 1;
+            Data* outA = out + fa * bins;
+            Data* outB = out + fb * bins;
+            for (s64 k = 0; k < bins; k++) {
+                s64 j = (N - k) % N;
+                Data ar = (r[k] + r[j]) / 2;
+                Data ai = (i[k] - i[j]) / 2;
+                Data br = (i[k] + i[j]) / 2;
+                Data bi = (r[j] - r[k]) / 2;
+                Data pa = ar * ar + ai * ai;
+                Data pb = br * br + bi * bi;
+                if (output == MAGNITUDE) {
+                    pa = std::sqrt(pa);
+                    pb = std::sqrt(pb);
+                }
+                if (fa < frames) outA[k] = pa;
+                if (fb < frames) outB[k] = pb;
+            }
+        }
+    }
+}
+
+s64 STFT::Process(const Data* signal, s64 samples, Data* out, int output)
+{
+    s64 frames = Frames(samples);
+    if (frames == 0) return 0;
+
+    s64 groups = (frames + 2 * PAIRS - 1) / (2 * PAIRS);
+    s64 t = (threads > 0) ? threads : (s64)pool->Workers() + 1;
+    if (frames * length < THREADLIMIT) t = 1;
+
+    pool->ParallelFor(0, groups, t, [this, signal, frames, out, output](s64 first, s64 last) {
+        Groups(this, signal, frames, first, last, out, output);
+    });
+
+    return frames;
+}
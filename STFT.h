@@ -0,0 +1,69 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+	Short-time Fourier transform of a real signal, the power or magnitude
+	spectrum of windowed frames of N samples, hop samples apart.
+
+	The frames are real, so two of them share a transform, one in the real
+	and one in the imaginary part, and are separated by the symmetry of
+	their spectra. PAIRS such transforms are one call of the plan with a
+	batched layout, which runs them one after the other, each through all
+	its stages. The frames are split in chunks that run on a ThreadPool, each
+	with its own batch buffer, and only the spectra are written to the output.
+*/
+#include "PrimeFactorDFT.h"
+#include "ThreadPool.h"
+
+class STFT
+{
+public:
+	enum { POWER, MAGNITUDE };
+
+	STFT() { length = 0; hop = 0; threads = 0; pool = ThreadPool::Default(); };
+	~STFT() {};
+
+	/*
+	*  Frames of the length given by the factors, a Hann window.
+	*  Returns the frame length, or the Status() of invalid factors.
+	*/
+	s64 SetFrame(factorSeq& factors, s64 _hop);
+
+	/* frame length values */
+	void SetWindow(const Data* _window);
+
+	/* chunks of frames, 0 is one per worker of the pool and one for the calling thread */
+	void SetThreads(int _threads) { threads = _threads; };
+
+	/* default ThreadPool::Default() */
+	void SetPool(ThreadPool* _pool) { pool = _pool; };
+
+	/* spectrum values per frame, N / 2 + 1 */
+	s64 Bins() { return length / 2 + 1; };
+	s64 Frames(s64 samples) { return (length <= 0 || samples < length) ? 0 : 1 + (samples - length) / hop; };
+
+	/*
+	*  The spectra of all whole frames of the signal, frame f starting at
+	*  signal[f * hop], bin k of frame f at out[f * Bins() + k]. A long
+	*  signal may go in pieces, the next piece starting at Frames() * hop.
+	*  Returns the number of frames.
+	*/
+	s64 Process(const Data* signal, s64 samples, Data* out, int output = POWER);
+
+private:
+	static void Groups(STFT* stft, const Data* signal, s64 frames, s64 first, s64 last, Data* out, int output);
+
+	PrimeFactorDFT pf;
+	s64 length;
+	s64 hop;
+	int threads;
+	ThreadPool* pool;
+	std::vector<Data> window;
+};
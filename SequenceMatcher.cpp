@@ -0,0 +1,143 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+*/
+
+#include "SequenceMatcher.h"
+
+/* 'balanced' representation */
+#define AT 3.0
+#define TA (-3.0)
+#define GC 1.0
+#define CG (-1.0)
+
+Data SequenceMatcher::Encode(char base)
+{
+    switch (base) {
+    case 'A': case 'a': return AT;
+    case 'T': case 't': return TA;
+    case 'G': case 'g': return GC;
+    case 'C': case 'c': return CG;
+    default: return 0;
+    }
+}
+
+/*
+    The correlation of a probe of m bases at position s needs the reference
+    up to s + m - 1, so with N >= reference + maxProbeLength - 1 nothing wraps.
+*/
+s64 SequenceMatcher::SetReference(const std::string& reference, s64 maxProbeLength)
+{
+    s64 wanted = (s64)reference.size() + maxProbeLength - 1;
+    if (reference.empty() || maxProbeLength < 1) return -1;
+
+    s64 N = pf.CalcFactors(wanted, factors);
+    if (N <= 0) return -1;
+    pf.SetFactors(factors);
+
+    referenceLength = reference.size();
+    maxProbe = maxProbeLength;
+
+    /* a probe is 0 except at 0 and N - maxProbe + 1, ..., N - 1 */
+    pf.Prune(N - maxProbe + 1, maxProbe, 0, N, probePruning);
+
+    refReal.assign(N, 0);
+    refImag.assign(N, 0);
+    for (s64 i = 0; i < referenceLength; i++) refReal[i] = Encode(reference[i]) / N;
+    pf.forwardFFT(refReal.data(), refImag.data());
+
+    real.resize(N);
+    imag.resize(N);
+    return N;
+}
+
+/*
+    probe[0] at 0 and probe[j] at N - j, so the convolution with the
+    reference at s is  sum reference[s + j] * probe[j].
+*/
+void SequenceMatcher::LoadProbe(const std::string& probe, Data* dest)
+{
+    s64 N = pf.Status();
+    for (s64 i = 0; i < N; i++) dest[i] = 0;
+    if (probe.empty()) return;
+    dest[0] = Encode(probe[0]);
+    for (s64 j = 1; j < (s64)probe.size(); j++) dest[N - j] = Encode(probe[j]);
+}
+
+/*
+    The correlations of the two probes of a transform, taken from the last
+    stage of the inverse transform.
+*/
+class ProbePairSink : public StageSink {
+public:
+    ProbePairSink(TopKPeaks* _first, TopKPeaks* _second) { first = _first; second = _second; };
+    void Consume(const s64* index, const Data* real, const Data* imag, int length, s64 batch)
+    {
+        first->Consume(index, real, imag, length, batch);
+        second->Consume(index, real, imag, length, batch);
+    };
+private:
+    TopKPeaks* first;
+    TopKPeaks* second;
+};
+
+void SequenceMatcher::Result(TopKPeaks& peaks, Data self, std::vector<SequenceMatch>& best)
+{
+    std::vector<Peak> found;
+    peaks.Result(found);
+
+    best.clear();
+    if (self <= 0) return;
+    for (std::size_t i = 0; i < found.size(); i++) {
+        SequenceMatch m = { found[i].index, found[i].value / self };
+        best.push_back(m);
+    }
+}
+
+void SequenceMatcher::Match(const std::vector<std::string>& probes, int topK, std::vector< std::vector<SequenceMatch> >& matches)
+{
+    s64 N = pf.Status();
+    matches.clear();
+    matches.resize(probes.size());
+    if (referenceLength == 0) return;
+
+    for (std::size_t p = 0; p < probes.size(); p += 2)
+    {
+        /* probes longer than maxProbeLength get no matches */
+        static const std::string none;
+        const std::string& first = ((s64)probes[p].size() <= maxProbe) ? probes[p] : none;
+        const std::string& second = (p + 1 < probes.size() && (s64)probes[p + 1].size() <= maxProbe) ? probes[p + 1] : none;
+
+        LoadProbe(first, real.data());
+        LoadProbe(second, imag.data());
+
+        pf.forwardFFT(real.data(), imag.data(), probePruning);
+        for (s64 i = 0; i < N; i++) {
+            Data tr = real[i] * refReal[i] - imag[i] * refImag[i];
+            Data ti = real[i] * refImag[i] + imag[i] * refReal[i];
+            real[i] = tr;
+            imag[i] = ti;
+        }
+
+        /* only the peaks are needed, the correlations are never stored */
+        TopKPeaks firstPeaks(topK, TopKPeaks::REAL, referenceLength - (s64)first.size() + 1);
+        TopKPeaks secondPeaks(topK, TopKPeaks::IMAG, referenceLength - (s64)second.size() + 1);
+        ProbePairSink sink(&firstPeaks, &secondPeaks);
+        pf.InverseFFT(real.data(), imag.data(), &sink, false);
+
+        Data self = 0;
+        for (std::size_t j = 0; j < first.size(); j++) self += Encode(first[j]) * Encode(first[j]);
+        Result(firstPeaks, self, matches[p]);
+
+        if (p + 1 < probes.size()) {
+            self = 0;
+            for (std::size_t j = 0; j < second.size(); j++) self += Encode(second[j]) * Encode(second[j]);
+            Result(secondPeaks, self, matches[p + 1]);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+	Searching many probe sequences in one reference sequence by correlation,
+	as in test2DNA, with the bases in the 'balanced' representation
+	A = 3, T = -3, G = 1, C = -1.
+
+	The reference is transformed once. The probes are real, so two of them
+	share a transform, one in the real and one in the imaginary part. The
+	reference is real as well, so the two correlations come out of the
+	inverse transform separated the same way. The best positions are picked
+	from the last stage of the inverse transform, which stores nothing.
+	The other stages run on a ThreadPool.
+*/
+#include <string>
+#include "PrimeFactorDFT.h"
+#include "ThreadPool.h"
+
+struct SequenceMatch {
+	/* start of the match in the reference */
+	s64 position;
+	/* correlation divided by the correlation of the probe with itself, 1.0 is a perfect match */
+	Data score;
+};
+
+class SequenceMatcher
+{
+public:
+
+	SequenceMatcher() { referenceLength = 0; maxProbe = 0; pf.SetPool(ThreadPool::Default()); };
+	~SequenceMatcher() {};
+
+	static Data Encode(char base);
+
+	/* default ThreadPool::Default(), 0 runs on the calling thread */
+	void SetPool(ThreadPool* pool) { pf.SetPool(pool); };
+
+	/*
+	*  Transforms the reference. Probes may be up to maxProbeLength bases.
+	*  Returns the transform length, or -1 if there is none.
+	*/
+	s64 SetReference(const std::string& reference, s64 maxProbeLength);
+
+	/*
+	*  For every probe the topK best positions, best first. Only positions where
+	*  the whole probe lies inside the reference are reported.
+	*/
+	void Match(const std::vector<std::string>& probes, int topK, std::vector< std::vector<SequenceMatch> >& matches);
+
+private:
+	void LoadProbe(const std::string& probe, Data* dest);
+	void Result(TopKPeaks& peaks, Data self, std::vector<SequenceMatch>& best);
+
+	PrimeFactorDFT pf;
+	factorSeq factors;
+	/* the forward transform of a probe skips its zero padding */
+	PrunedStages probePruning;
+	s64 referenceLength;
+	s64 maxProbe;
+	/* reference spectrum, scaled by 1/N */
+	std::vector<Data> refReal;
+	std::vector<Data> refImag;
+	std::vector<Data> real;
+	std::vector<Data> imag;
+};
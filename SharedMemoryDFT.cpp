@@ -0,0 +1,364 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "SharedMemoryDFT.h"
+
+#ifdef NOTWIN
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+    At the start of the shared mapping, the data follows on the next page.
+    The caller starts a transform by a new generation and waits on done for
+    finished to reach processes, stage is the barrier of the workers only.
+    The caller never waits longer than WAITSLICE without looking for dead
+    workers, a worker that dies leaves the others at the stage barrier.
+    The lock is robust, so a worker killed holding it does not stop the caller.
+*/
+struct SharedControl {
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    pthread_barrier_t stage;
+    s64 generation;
+    int command;
+    int finished;
+    int processes;
+};
+
+#define CONTROLBYTES ((s64)4096)
+
+/* nanoseconds the caller waits between looking at the workers */
+#define WAITSLICE ((s64)20000000)
+
+/* seconds a worker waits between looking for its parent */
+#define PARENTSLICE 1
+
+static void Lock(pthread_mutex_t* lock)
+{
+    if (pthread_mutex_lock(lock) == EOWNERDEAD) pthread_mutex_consistent(lock);
+}
+
+static void After(clockid_t clock, s64 nanoseconds, timespec& at)
+{
+    clock_gettime(clock, &at);
+    nanoseconds += at.tv_nsec;
+    at.tv_sec += (time_t)(nanoseconds / 1000000000);
+    at.tv_nsec = (long)(nanoseconds % 1000000000);
+}
+#endif
+
+int SharedMemoryDFT::Nodes()
+{
+    int nodes = 0;
+#ifdef NOTWIN
+    char path[64];
+    for (;;) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d", nodes);
+        if (access(path, F_OK) != 0) break;
+        nodes++;
+    }
+#endif
+    return (nodes > 0) ? nodes : 1;
+}
+
+#ifdef NOTWIN
+/*
+    The CPUs of a node from its cpulist, "0-15,32-47".
+*/
+static bool NodeCpus(int node, cpu_set_t& set)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+
+    char list[4096];
+    bool any = false;
+    CPU_ZERO(&set);
+    if (fgets(list, sizeof(list), f)) {
+        char* p = list;
+        while (*p && *p != '\n') {
+            char* next;
+            long first = strtol(p, &next, 10);
+            if (next == p) break;
+            long last = first;
+            p = next;
+            if (*p == '-') last = strtol(p + 1, &p, 10);
+            for (long c = first; c <= last && c < CPU_SETSIZE; c++) {
+                CPU_SET((int)c, &set);
+                any = true;
+            }
+            if (*p == ',') p++;
+        }
+    }
+    fclose(f);
+    return any;
+}
+
+/* the affinity of a worker, read by Open before the fork */
+struct WorkerCpus {
+    cpu_set_t set;
+    bool any;
+};
+#endif
+
+s64 SharedMemoryDFT::Open(factorSeq& factors, int processes, bool pin)
+{
+    Close();
+
+    pf.SetFactors(factors);
+    if (pf.Status() <= 0) return pf.Status();
+
+#ifdef NOTWIN
+    s64 N = pf.Status();
+    int nodes = Nodes();
+    if (processes <= 0) processes = nodes;
+
+    mapBytes = CONTROLBYTES + 2 * N * (s64)sizeof(Data);
+    void* m = mmap(0, mapBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (m == MAP_FAILED) {
+        mapBytes = 0;
+        return -1;
+    }
+    control = (SharedControl*)m;
+    map = (Data*)((char*)m + CONTROLBYTES);
+    length = N;
+
+    pthread_mutexattr_t lockAttr;
+    pthread_mutexattr_init(&lockAttr);
+    pthread_mutexattr_setpshared(&lockAttr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&lockAttr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&control->lock, &lockAttr);
+    pthread_mutexattr_destroy(&lockAttr);
+
+    pthread_condattr_t condAttr;
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setpshared(&condAttr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&control->start, &condAttr);
+    pthread_cond_init(&control->done, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+
+    pthread_barrierattr_t barrierAttr;
+    pthread_barrierattr_init(&barrierAttr);
+    pthread_barrierattr_setpshared(&barrierAttr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(&control->stage, &barrierAttr, processes);
+    pthread_barrierattr_destroy(&barrierAttr);
+
+    control->generation = 0;
+    control->command = EXIT;
+    control->finished = 0;
+    control->processes = processes;
+
+    /* the child of a fork only makes system calls until its loop, no stdio */
+    std::vector<WorkerCpus> cpus(nodes);
+    for (int node = 0; node < nodes; node++)
+        cpus[node].any = pin && NodeCpus(node, cpus[node].set);
+
+    pid_t parent = getpid();
+    for (int i = 0; i < processes; i++) {
+        pid_t pid = fork();
+        if (pid == 0) Worker(i, &cpus[i % nodes], parent);
+        if (pid < 0) {
+            /* the stage barrier waits for all, so give up */
+            Close();
+            return -1;
+        }
+        workers.push_back(pid);
+    }
+
+    if (!Run(TOUCH)) {
+        Close();
+        return -1;
+    }
+    return length;
+#else
+    (void)processes;
+    (void)pin;
+    return -1;
+#endif
+}
+
+void SharedMemoryDFT::Close()
+{
+#ifdef NOTWIN
+    if (control) {
+        if (!workers.empty()) {
+            Lock(&control->lock);
+            control->command = EXIT;
+            control->generation++;
+            pthread_cond_broadcast(&control->start);
+            pthread_mutex_unlock(&control->lock);
+
+            /* a worker that does not leave within a slice is stuck */
+            timespec pause = { 0, (long)WAITSLICE };
+            for (int tries = 0; tries < 50 && Alive() > 0; tries++)
+                nanosleep(&pause, 0);
+            Stop();
+        }
+        /* no destroy, it waits for a killed worker to leave the barrier */
+        munmap(control, mapBytes);
+    }
+#endif
+    workers.clear();
+    control = 0;
+    map = 0;
+    mapBytes = 0;
+    length = 0;
+}
+
+/*
+    Reaps the workers that have ended, returns the number still running.
+*/
+int SharedMemoryDFT::Alive()
+{
+    int alive = 0;
+#ifdef NOTWIN
+    for (std::size_t w = 0; w < workers.size(); w++) {
+        if (workers[w] <= 0) continue;
+        if (waitpid(workers[w], 0, WNOHANG) == workers[w]) workers[w] = 0;
+        else alive++;
+    }
+#endif
+    return alive;
+}
+
+/*
+    Kills and reaps the workers still running, the data stays mapped.
+*/
+void SharedMemoryDFT::Stop()
+{
+#ifdef NOTWIN
+    for (std::size_t w = 0; w < workers.size(); w++)
+        if (workers[w] > 0) kill(workers[w], SIGKILL);
+    for (std::size_t w = 0; w < workers.size(); w++)
+        if (workers[w] > 0) waitpid(workers[w], 0, 0);
+#endif
+    workers.clear();
+}
+
+bool SharedMemoryDFT::Run(int command)
+{
+#ifdef NOTWIN
+    if (!control || workers.empty()) return false;
+
+    Lock(&control->lock);
+    control->command = command;
+    control->finished = 0;
+    control->generation++;
+    pthread_cond_broadcast(&control->start);
+
+    bool ok = true;
+    while (control->finished < control->processes) {
+        timespec at;
+        After(CLOCK_MONOTONIC, WAITSLICE, at);
+        int error = pthread_cond_timedwait(&control->done, &control->lock, &at);
+        if (error == EOWNERDEAD) pthread_mutex_consistent(&control->lock);
+        if (error != 0 && Alive() < (int)workers.size()) {
+            ok = false;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&control->lock);
+
+    /* the others wait at the stage barrier for the dead one */
+    if (!ok) Stop();
+    return ok;
+#else
+    (void)command;
+    return false;
+#endif
+}
+
+/*
+    The loop of worker process index, it never returns. It ends when told
+    to or when the caller's process, parent, is gone. It runs in the child
+    of a fork, so it does not allocate or read files before the loop.
+*/
+void SharedMemoryDFT::Worker(int index, const WorkerCpus* cpus, int parent)
+{
+#ifdef NOTWIN
+    if (cpus->any)
+        sched_setaffinity(0, sizeof(cpus->set), &cpus->set);
+
+    /* Open forks all before the first generation, the caller may be past it */
+    int processes = control->processes;
+    s64 seen = 0;
+    for (;;)
+    {
+        Lock(&control->lock);
+        while (control->generation == seen) {
+            timespec at;
+            After(CLOCK_MONOTONIC, (s64)PARENTSLICE * 1000000000, at);
+            int error = pthread_cond_timedwait(&control->start, &control->lock, &at);
+            if (error == EOWNERDEAD) pthread_mutex_consistent(&control->lock);
+            if (getppid() != parent) _exit(1);
+        }
+        seen = control->generation;
+        int command = control->command;
+        pthread_mutex_unlock(&control->lock);
+
+        if (command == EXIT) _exit(0);
+
+        if (command == TOUCH) {
+            /* first touch, block index of real and imag */
+            s64 first = index * length / processes;
+            s64 last = (index + 1) * length / processes;
+            memset(Real() + first, 0, (last - first) * sizeof(Data));
+            memset(Imag() + first, 0, (last - first) * sizeof(Data));
+        }
+        else
+        for (std::size_t s = 0; s < pf.Stages(); s++)
+        {
+            s64 count = pf.Butterflies(s);
+            s64 begin = index * count / processes;
+            s64 end = (index + 1) * count / processes;
+            if (command == INVERSE)
+                pf.InverseStage(s, Real(), Imag(), begin, end);
+            else
+                pf.forwardStage(s, Real(), Imag(), begin, end);
+            pthread_barrier_wait(&control->stage);
+        }
+
+        Lock(&control->lock);
+        if (++control->finished == processes) pthread_cond_signal(&control->done);
+        pthread_mutex_unlock(&control->lock);
+    }
+#else
+    (void)index;
+    (void)cpus;
+    (void)parent;
+#endif
+}
+
+bool SharedMemoryDFT::ScaledInverseFFT()
+{
+    if (!InverseFFT()) return false;
+
+    Data* real = Real();
+    Data* imag = Imag();
+    for (s64 i = 0; i < length; i++) {
+        real[i] /= length;
+        imag[i] /= length;
+    }
+    return true;
+}
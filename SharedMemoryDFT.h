@@ -0,0 +1,91 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+	Transforms run by several worker processes on data in shared memory.
+
+	The modules of the PFA have no twiddles between the stages, so the
+	butterflies of a stage are independent. Every worker process runs its
+	share of the butterflies of a stage, 1 / processes of them, and the
+	workers meet at a process-shared barrier before the next stage. The
+	caller's process only starts a transform and waits for the end, its
+	threads and their CPU affinity are left alone.
+
+	Worker i runs on the CPUs of NUMA node i % nodes, read from
+	/sys/devices/system/node by Open before it forks, and the data is first written by the
+	workers, each its own block, so the pages are spread over the nodes.
+	Each worker has its own heap, there is no allocator shared between
+	the sockets. A butterfly reads points from all of the array, so a
+	stage still reads from every node.
+
+	The workers are forked by Open, so call it before starting threads
+	that the children should not inherit locks of. The caller waits in
+	slices and looks for dead workers in between, a transform that loses
+	a worker, killed or out of memory, returns false and the remaining
+	workers are killed. The data stays mapped until Close. A worker ends
+	by itself when the caller's process is gone. Not available on Windows.
+*/
+#include "PrimeFactorDFT.h"
+
+struct SharedControl;
+struct WorkerCpus;
+
+class SharedMemoryDFT
+{
+public:
+
+	SharedMemoryDFT() { map = 0; mapBytes = 0; length = 0; control = 0; };
+	~SharedMemoryDFT() { Close(); };
+
+	/*
+	*  Maps the data for a transform with these factors and starts processes
+	*  workers, 0 is one per NUMA node. With pin worker i only runs on node
+	*  i % nodes. The data holds 0.
+	*  Returns the length, -1 if the memory or the processes can not be had,
+	*  or the Status() of invalid factors.
+	*/
+	s64 Open(factorSeq& factors, int processes = 0, bool pin = true);
+
+	/* stops the workers and unmaps the data */
+	void Close();
+
+	/* the number of workers, 0 after a worker died */
+	int Processes() { return (int)workers.size(); };
+
+	/* the process id of worker i */
+	int ProcessId(int i) { return workers[i]; };
+
+	/* the shared data */
+	Data* Real() { return map; };
+	Data* Imag() { return map ? map + length : 0; };
+
+	/* false if there are no workers or one died during the transform */
+	bool forwardFFT() { return Run(FORWARD); };
+	bool InverseFFT() { return Run(INVERSE); };
+	bool ScaledInverseFFT();
+
+	/* number of NUMA nodes, 1 if the system does not tell */
+	static int Nodes();
+
+private:
+	enum { FORWARD, INVERSE, TOUCH, EXIT };
+
+	bool Run(int command);
+	int Alive();
+	void Stop();
+	void Worker(int index, const WorkerCpus* cpus, int parent);
+
+	PrimeFactorDFT pf;
+	Data* map;
+	s64 mapBytes;
+	s64 length;
+	SharedControl* control;
+	std::vector<int> workers;
+};
@@ -0,0 +1,108 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+*/
+
+#include <cmath>
+#include "SlidingDFT.h"
+
+s64 SlidingDFT::SetLength(factorSeq& factors, s64 _resync)
+{
+    pf.SetFactors(factors);
+    length = pf.Status();
+    if (length <= 0) return length;
+
+    resync = (_resync > 0) ? _resync : length;
+    transform = pf.Operations();
+
+    cosine.resize(length);
+    sine.resize(length);
+    for (s64 k = 0; k < length; k++) {
+        long double w = 2.0L * 3.141592653589793238462643383279503L * k / length;
+        cosine[k] = (Data)std::cos(w);
+        sine[k] = (Data)std::sin(w);
+    }
+
+    windowReal.resize(length);
+    windowImag.resize(length);
+    spectrumReal.resize(length);
+    spectrumImag.resize(length);
+    Reset();
+    return length;
+}
+
+void SlidingDFT::Reset()
+{
+    for (s64 i = 0; i < length; i++) {
+        windowReal[i] = 0;
+        windowImag[i] = 0;
+        spectrumReal[i] = 0;
+        spectrumImag[i] = 0;
+    }
+    head = 0;
+    sinceSync = 0;
+}
+
+void SlidingDFT::Slide(Data real, Data imag)
+{
+    Data dr = real - windowReal[head];
+    Data di = imag - windowImag[head];
+    windowReal[head] = real;
+    windowImag[head] = imag;
+    if (++head == length) head = 0;
+
+    Data* xr = spectrumReal.data();
+    Data* xi = spectrumImag.data();
+    const Data* c = cosine.data();
+    const Data* s = sine.data();
+    for (s64 k = 0; k < length; k++) {
+        Data tr = xr[k] + dr;
+        Data ti = xi[k] + di;
+        xr[k] = tr * c[k] - ti * s[k];
+        xi[k] = tr * s[k] + ti * c[k];
+    }
+}
+
+void SlidingDFT::Resync()
+{
+    if (length <= 0) return;
+
+    for (s64 i = 0; i < length; i++) {
+        s64 j = (head + i < length) ? head + i : head + i - length;
+        spectrumReal[i] = windowReal[j];
+        spectrumImag[i] = windowImag[j];
+    }
+    pf.forwardFFT(spectrumReal.data(), spectrumImag.data());
+    sinceSync = 0;
+}
+
+/*
+    A slide is a complex add and multiply per bin, 8 operations.
+*/
+void SlidingDFT::Push(const Data* real, const Data* imag, s64 n)
+{
+    if (length <= 0 || n <= 0) return;
+
+    if (8 * n * length >= transform || sinceSync + n >= resync)
+    {
+        /* only the last N samples stay in the window */
+        s64 first = (n > length) ? n - length : 0;
+        for (s64 i = first; i < n; i++) {
+            windowReal[head] = real[i];
+            windowImag[head] = imag ? imag[i] : 0;
+            if (++head == length) head = 0;
+        }
+        Resync();
+        return;
+    }
+
+    for (s64 i = 0; i < n; i++)
+        Slide(real[i], imag ? imag[i] : 0);
+    sinceSync += n;
+}
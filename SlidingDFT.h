@@ -0,0 +1,73 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+	The spectrum of the last N samples of a stream, kept up to date sample
+	by sample.
+
+	A new sample changes the spectrum by
+		X[k] = (X[k] - oldest + newest) * e^(2 pi i k / N)
+	which is O(N) per sample. The rounding errors of the updates add up, so
+	every resync samples the spectrum is recomputed by a full transform of
+	the window. A block of samples that costs more to slide in than a full
+	transform goes in as a full transform right away.
+*/
+#include "PrimeFactorDFT.h"
+
+class SlidingDFT
+{
+public:
+
+	SlidingDFT() { length = 0; resync = 0; transform = 0; head = 0; sinceSync = 0; };
+	~SlidingDFT() {};
+
+	/*
+	*  A window of the length given by the factors, recomputed every _resync
+	*  samples, default every N samples. The window starts out all 0.
+	*  Returns the length, or the Status() of invalid factors.
+	*/
+	s64 SetLength(factorSeq& factors, s64 _resync = 0);
+
+	/* window and spectrum back to 0 */
+	void Reset();
+
+	/*
+	*  n new samples, imag may be 0 for a real stream.
+	*/
+	void Push(const Data* real, const Data* imag, s64 n);
+
+	/* recomputes the spectrum from the window */
+	void Resync();
+
+	/* the spectrum of the window, the oldest sample at n = 0 */
+	const Data* SpectrumReal() { return spectrumReal.data(); };
+	const Data* SpectrumImag() { return spectrumImag.data(); };
+
+	s64 Length() { return length; };
+
+private:
+	void Slide(Data real, Data imag);
+
+	PrimeFactorDFT pf;
+	s64 length;
+	s64 resync;
+	/* operations of a full transform */
+	s64 transform;
+	/* the window, oldest sample at head */
+	std::vector<Data> windowReal;
+	std::vector<Data> windowImag;
+	s64 head;
+	s64 sinceSync;
+	std::vector<Data> spectrumReal;
+	std::vector<Data> spectrumImag;
+	/* e^(2 pi i k / N) */
+	std::vector<Data> cosine;
+	std::vector<Data> sine;
+};
@@ -0,0 +1,85 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+*/
+
+#include <cmath>
+#include "SlowFFT.h"
+
+void SlowFFT::SetFactors(factorSeq& _factors)
+{
+    factors = _factors;
+    state = ValidateFactors(factors);
+    roots.clear();
+    if (state <= 0) return;
+
+    long double pi = 3.141592653589793238462643383279502884L;
+    roots.resize(state);
+    for (s64 j = 0; j < state; j++) {
+        long double a = -2 * pi * (long double)j / (long double)state;
+        roots[j] = Complex(std::cos(a), std::sin(a));
+    }
+}
+
+void SlowFFT::Transform(Data* real, Data *imag, bool inverse)
+{
+    if (state <= 0) return;
+
+    in.resize(state);
+    out.resize(state);
+    for (s64 i = 0; i < state; i++) in[i] = Complex(real[i], imag[i]);
+
+    Recurse(in.data(), 1, out.data(), state, 0, inverse);
+
+    for (s64 i = 0; i < state; i++) {
+        real[i] = (Data)out[i].real();
+        imag[i] = (Data)out[i].imag();
+    }
+}
+
+/*
+    The length points in[n * inStride] split by n mod p into p sequences of
+    length M = length / p, and with Y_r their transforms
+
+        X[k + q * M] = sum  W^(r * q * M) * W^(r * k) * Y_r[k],   W = e^(-2 pi i / length)
+
+    W^j of the length is roots[j * N / length].
+*/
+void SlowFFT::Recurse(const Complex* in, s64 inStride, Complex* out, s64 length, std::size_t factor, bool inverse)
+{
+    if (length == 1) {
+        out[0] = in[0];
+        return;
+    }
+
+    s64 p = factors[factor];
+    s64 M = length / p;
+    s64 step = state / length;
+
+    for (s64 r = 0; r < p; r++)
+        Recurse(in + r * inStride, inStride * p, out + r * M, M, factor + 1, inverse);
+
+    Complex y[31];
+    for (s64 k = 0; k < M; k++)
+    {
+        for (s64 r = 0; r < p; r++) {
+            Complex w = roots[r * k * step];
+            y[r] = out[r * M + k] * (inverse ? std::conj(w) : w);
+        }
+        for (s64 q = 0; q < p; q++) {
+            Complex sum = 0;
+            for (s64 r = 0; r < p; r++) {
+                Complex w = roots[((r * q) % p) * M * step];
+                sum += y[r] * (inverse ? std::conj(w) : w);
+            }
+            out[q * M + k] = sum;
+        }
+    }
+}
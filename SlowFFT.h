@@ -0,0 +1,48 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+	Reference transforms to check PrimeFactorDFT against.
+
+	SlowFFT takes the same factors and computes the same DFT, unnormalized
+	and with e^(-2 pi i n k / N) forward, by a plain recursive decimation in
+	time: one naive DFT of length p per point and factor p, so N * (sum of
+	the factors) operations instead of N^2. It runs in long double with
+	the twiddles taken from one table of the N roots of unity, each computed
+	directly, so its error stays well below that of a double transform.
+	Needs 6 * N long doubles of memory: the roots, the input and the output,
+	each N complex long doubles.
+*/
+#include <complex>
+#include "PrimeFactorDFT.h"
+
+class SlowFFT : public PrimeFactorPlan
+{
+public:
+
+	SlowFFT() {};
+	~SlowFFT() {};
+
+	void SetFactors(factorSeq& _factors);
+
+	void forwardFFT(Data* real, Data *imag) { Transform(real, imag, false); };
+	void InverseFFT(Data* real, Data *imag) { Transform(real, imag, true); };
+
+private:
+	typedef std::complex<long double> Complex;
+
+	void Transform(Data* real, Data *imag, bool inverse);
+	void Recurse(const Complex* in, s64 inStride, Complex* out, s64 length, std::size_t factor, bool inverse);
+
+	/* roots[j] = e^(-2 pi i j / N) */
+	std::vector<Complex> roots;
+	std::vector<Complex> in;
+	std::vector<Complex> out;
+};
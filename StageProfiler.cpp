@@ -0,0 +1,160 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+*/
+
+#include <chrono>
+#include "StageProfiler.h"
+
+#if defined(NOTWIN) && defined(__linux__)
+#define PFA_PERF_EVENTS
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+StageProfiler::StageProfiler()
+{
+    runs = 0;
+    length = 0;
+    for (int i = 0; i < 3; i++) fds[i] = -1;
+
+#ifdef PFA_PERF_EVENTS
+    static const u64 events[3] = { PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_CACHE_MISSES };
+    for (int i = 0; i < 3; i++) {
+        struct perf_event_attr attr = {};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = events[i];
+        attr.disabled = (i == 0) ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, (i == 0) ? -1 : fds[0], 0);
+        if (fds[i] < 0) {
+            /* all or nothing */
+            for (int j = 0; j < i; j++) { close(fds[j]); fds[j] = -1; }
+            break;
+        }
+    }
+#endif
+}
+
+StageProfiler::~StageProfiler()
+{
+#ifdef PFA_PERF_EVENTS
+    for (int i = 0; i < 3; i++)
+        if (fds[i] >= 0) close(fds[i]);
+#endif
+}
+
+void StageProfiler::StartCounters()
+{
+#ifdef PFA_PERF_EVENTS
+    if (fds[0] < 0) return;
+    ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+void StageProfiler::StopCounters(s64 values[3])
+{
+    for (int i = 0; i < 3; i++) values[i] = -1;
+#ifdef PFA_PERF_EVENTS
+    if (fds[0] < 0) return;
+    ioctl(fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    /* the number of events, then their values */
+    u64 group[4];
+    if (read(fds[0], group, sizeof(group)) != (ssize_t)sizeof(group) || group[0] != 3) return;
+    for (int i = 0; i < 3; i++) values[i] = (s64)group[i + 1];
+#endif
+}
+
+s64 StageProfiler::Profile(PrimeFactorDFT& pf, Data* real, Data *imag, bool inverse)
+{
+    if (pf.Status() <= 0) return pf.Status();
+
+    factorSeq factors;
+    pf.GetFactors(factors);
+
+    bool same = (length == pf.Status() && records.size() == factors.size());
+    for (std::size_t s = 0; same && s < factors.size(); s++)
+        same = (records[s].factor == factors[s]);
+    if (!same) {
+        Clear();
+        length = pf.Status();
+        for (std::size_t s = 0; s < factors.size(); s++) {
+            StageRecord r = {};
+            r.factor = factors[s];
+            r.butterflies = pf.Butterflies(s) * pf.BatchCount();
+            ModuleCost cost = ModuleCostOf(factors[s]);
+            r.operations = r.butterflies * cost.Operations();
+            r.bytes = r.butterflies * (cost.loads + cost.stores) * (s64)sizeof(Data);
+            r.instructions = Counters() ? 0 : -1;
+            r.cycles = Counters() ? 0 : -1;
+            r.cacheMisses = Counters() ? 0 : -1;
+            records.push_back(r);
+        }
+    }
+
+    /* the batches are independent, so a stage can run on all of them before the next */
+    for (std::size_t s = 0; s < pf.Stages(); s++)
+    {
+        s64 values[3];
+        s64 count = pf.Butterflies(s);
+
+        StartCounters();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (s64 b = 0; b < pf.BatchCount(); b++) {
+            Data* r = real + b * pf.BatchDistance();
+            Data* i = imag + b * pf.BatchDistance();
+            if (inverse) pf.InverseStage(s, r, i, 0, count);
+            else pf.forwardStage(s, r, i, 0, count);
+        }
+        std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+        StopCounters(values);
+
+        StageRecord& rec = records[s];
+        rec.seconds += std::chrono::duration<double>(stop - start).count();
+        if (values[0] >= 0) {
+            rec.instructions += values[0];
+            rec.cycles += values[1];
+            rec.cacheMisses += values[2];
+        }
+    }
+    runs++;
+    return pf.Stages();
+}
+
+void StageProfiler::WriteJSON(std::ostream& out)
+{
+    double r = (runs > 0) ? (double)runs : 1.0;
+
+    out << "{\"length\": " << length << ", \"runs\": " << runs
+        << ", \"counters\": " << (Counters() ? "true" : "false") << ", \"stages\": [";
+    for (std::size_t s = 0; s < records.size(); s++)
+    {
+        const StageRecord& rec = records[s];
+        out << ((s > 0) ? ", " : "") << "{\"stage\": " << s
+            << ", \"factor\": " << rec.factor
+            << ", \"butterflies\": " << rec.butterflies
+            << ", \"operations\": " << rec.operations
+            << ", \"bytes\": " << rec.bytes
+            << ", \"seconds\": " << rec.seconds / r
+            << ", \"opsPerByte\": " << (double)rec.operations / rec.bytes;
+        if (Counters())
+            out << ", \"instructions\": " << rec.instructions / r
+                << ", \"cycles\": " << rec.cycles / r
+                << ", \"cacheMisses\": " << rec.cacheMisses / r;
+        out << "}";
+    }
+    out << "]}" << std::endl;
+}
@@ -0,0 +1,85 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+	Per-stage timing and hardware counters of a transform.
+
+	Profile runs the transform of a PrimeFactorDFT stage by stage through
+	the stage API and records, for every stage, the wall time, the
+	butterflies, the real operations and the bytes of data read and
+	written. On Linux the instructions retired, the cycles and the last
+	level cache misses of each stage are read with perf_event_open as
+	well, counting user space only, so kernel.perf_event_paranoid <= 2 is
+	enough. Where the counters can not be opened they are -1.
+
+	A stage reads and writes every point of real and imag once, so its
+	operations per byte is ops / (4 * N * sizeof(Data)), e.g. 0.06 for
+	factor 2 and 0.9 for factor 31. Stages with a low ratio and a high
+	miss count are bound by memory, the others by the arithmetic.
+	The plan itself is not changed, its transforms run as before.
+*/
+#include <ostream>
+#include "PrimeFactorDFT.h"
+
+struct StageRecord {
+	uint factor;
+	s64 butterflies;
+	/* per run, real additions and multiplications */
+	s64 operations;
+	/* per run, data read and written */
+	s64 bytes;
+	/* the sums over all runs */
+	double seconds;
+	s64 instructions;
+	s64 cycles;
+	s64 cacheMisses;
+};
+
+class StageProfiler
+{
+public:
+
+	StageProfiler();
+	~StageProfiler();
+
+	/*
+	*  One transform, with the batch, of pf on real, imag. The times and
+	*  counters are added to the records, which are started over when the
+	*  plan has other factors than the previous run.
+	*  Returns the number of stages, or the Status() of an invalid plan.
+	*/
+	s64 forwardFFT(PrimeFactorDFT& pf, Data* real, Data *imag) { return Profile(pf, real, imag, false); };
+	s64 InverseFFT(PrimeFactorDFT& pf, Data* real, Data *imag) { return Profile(pf, real, imag, true); };
+
+	/* true if the hardware counters could be opened */
+	bool Counters() { return fds[0] >= 0; };
+
+	s64 Runs() { return runs; };
+	const std::vector<StageRecord>& Records() { return records; };
+	void Clear() { records.clear(); runs = 0; };
+
+	/*
+	*  {"length": N, "runs": r, "counters": true, "stages": [{"stage": 0,
+	*  "factor": 31, "butterflies": ..., "seconds": ..., ...}, ...]}
+	*  with the times and counters per run.
+	*/
+	void WriteJSON(std::ostream& out);
+
+private:
+	s64 Profile(PrimeFactorDFT& pf, Data* real, Data *imag, bool inverse);
+	void StartCounters();
+	void StopCounters(s64 values[3]);
+
+	/* instructions, cycles, cache misses; the first leads the group */
+	int fds[3];
+	std::vector<StageRecord> records;
+	s64 runs;
+	s64 length;
+};
@@ -0,0 +1,101 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+*/
+
+#include "StreamFilter.h"
+
+s64 StreamFilter::SetKernel(const Data* kernel, s64 _taps, s64 minLength)
+{
+    s64 wanted = 4 * _taps;
+    if (wanted < minLength) wanted = minLength;
+    if (_taps < 1) return -1;
+
+    s64 N = pf.CalcFactors(wanted, factors);
+    if (N <= 0) return -1;
+
+    pf.SetFactors(factors);
+    taps = _taps;
+    length = N;
+    step = N - taps + 1;
+
+    kernelReal.assign(N, 0);
+    kernelImag.assign(N, 0);
+    for (s64 i = 0; i < taps; i++) kernelReal[i] = kernel[i] / N;
+    pf.forwardFFT(kernelReal.data(), kernelImag.data());
+
+    window.resize(taps - 1 + 2 * step);
+    output.resize(2 * step);
+    real.resize(N);
+    imag.resize(N);
+    Reset();
+
+    return N;
+}
+
+void StreamFilter::Reset()
+{
+    for (std::size_t i = 0; i < window.size(); i++) window[i] = 0;
+    for (std::size_t i = 0; i < output.size(); i++) output[i] = 0;
+    filled = 0;
+}
+
+void StreamFilter::Push(const Data* in, s64 n, Data* out)
+{
+    while (n > 0) {
+        s64 k = 2 * step - filled;
+        if (k > n) k = n;
+
+        Data* w = window.data() + (taps - 1) + filled;
+        Data* o = output.data() + filled;
+        for (s64 i = 0; i < k; i++) {
+            w[i] = in[i];
+            out[i] = o[i];
+        }
+
+        filled += k;
+        in += k;
+        out += k;
+        n -= k;
+
+        if (filled == 2 * step) {
+            ProcessBlocks();
+            filled = 0;
+        }
+    }
+}
+
+/*
+    Block A is window[0, N), block B is window[L, L + N). The last M - 1
+    outputs of the circular convolution of each block are the valid ones.
+*/
+void StreamFilter::ProcessBlocks()
+{
+    for (s64 i = 0; i < length; i++) {
+        real[i] = window[i];
+        imag[i] = window[step + i];
+    }
+
+    pf.forwardFFT(real.data(), imag.data());
+    for (s64 i = 0; i < length; i++) {
+        Data tr = real[i] * kernelReal[i] - imag[i] * kernelImag[i];
+        Data ti = real[i] * kernelImag[i] + imag[i] * kernelReal[i];
+        real[i] = tr;
+        imag[i] = ti;
+    }
+    pf.InverseFFT(real.data(), imag.data());
+
+    for (s64 i = 0; i < step; i++) {
+        output[i] = real[taps - 1 + i];
+        output[step + i] = imag[taps - 1 + i];
+    }
+
+    /* the history of the next pair of blocks */
+    for (s64 i = 0; i < taps - 1; i++)
+        window[i] = window[2 * step + i];
+}
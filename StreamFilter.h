@@ -0,0 +1,71 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+	FIR filtering of an unbounded real sample stream by overlap-save.
+
+	With a kernel of M taps and transform length N every block yields
+	L = N - M + 1 output samples. The kernel is real, so two consecutive
+	blocks go through one transform, one in the real and one in the
+	imaginary part, and come out separated the same way.
+*/
+#include "PrimeFactorDFT.h"
+
+class StreamFilter
+{
+public:
+
+	StreamFilter() { taps = 0; length = 0; step = 0; filled = 0; };
+	~StreamFilter() {};
+
+	/*
+	*  Sets the filter kernel, y[t] = sum kernel[j] * x[t - j].
+	*  The transform length is the smallest supported length >= minLength
+	*  and >= 4 * taps. All buffers are allocated here.
+	*  Returns the transform length, or -1 if there is none.
+	*/
+	s64 SetKernel(const Data* kernel, s64 _taps, s64 minLength = 0);
+
+	/*
+	*  Filters n input samples into n output samples. out[i] is the filter
+	*  output for the input sample Latency() samples before in[i], the first
+	*  Latency() outputs of the stream are 0. Does not allocate.
+	*/
+	void Push(const Data* in, s64 n, Data* out);
+
+	/*
+	*  Clears the stream history, the kernel is kept.
+	*/
+	void Reset();
+
+	s64 Latency() { return 2 * step; };
+	s64 Length() { return length; };
+
+private:
+	void ProcessBlocks();
+
+	PrimeFactorDFT pf;
+	factorSeq factors;
+	s64 taps;
+	s64 length;
+	/* new samples per block, L */
+	s64 step;
+	/* new samples in the current pair of blocks */
+	s64 filled;
+
+	/* kernel spectrum, scaled by 1/N */
+	std::vector<Data> kernelReal;
+	std::vector<Data> kernelImag;
+	/* M-1 samples of history followed by 2L new samples */
+	std::vector<Data> window;
+	/* outputs of the previous pair of blocks */
+	std::vector<Data> output;
+	std::vector<Data> real;
+	std::vector<Data> imag;
+};
@@ -0,0 +1,192 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+*/
+
+#include <memory>
+#include "ThreadPool.h"
+
+#ifdef NOTWIN
+#include <sched.h>
+#endif
+
+/* the worker running on this thread, if any */
+static thread_local ThreadPool* currentPool = 0;
+static thread_local int currentWorker = -1;
+
+ThreadPool::ThreadPool(int workers, const std::vector<int>& cpus)
+{
+    stop = false;
+    pending = 0;
+    if (workers <= 0) workers = (int)std::thread::hardware_concurrency() - 1;
+    if (workers < 0) workers = 0;
+
+    for (int i = 0; i <= workers; i++) queues.push_back(new Queue());
+    for (int i = 0; i < workers; i++)
+        threads.push_back(std::thread(&ThreadPool::Worker, this, i, cpus.empty() ? -1 : cpus[i % cpus.size()]));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stop = true;
+    }
+    wake.notify_all();
+    for (std::size_t i = 0; i < threads.size(); i++) threads[i].join();
+    while (queues.size()) {
+        delete queues.back();
+        queues.pop_back();
+    }
+}
+
+ThreadPool* ThreadPool::Default()
+{
+    static ThreadPool pool;
+    return &pool;
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+    if (threads.empty()) {
+        task();
+        return;
+    }
+
+    Queue* q = (currentPool == this) ? queues[currentWorker] : queues.back();
+    {
+        std::lock_guard<std::mutex> guard(q->lock);
+        q->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        pending++;
+    }
+    wake.notify_one();
+}
+
+/*
+    Own queue from the back, then the shared queue and the other workers from the front.
+*/
+bool ThreadPool::Take(int id, std::function<void()>& task)
+{
+    int n = (int)queues.size();
+    for (int k = 0; k < n; k++)
+    {
+        int i = (id < 0) ? (n - 1 + k) % n : (k == 0) ? id : (k == 1) ? n - 1 : (id + k - 1) % (n - 1);
+        Queue* q = queues[i];
+        std::lock_guard<std::mutex> guard(q->lock);
+        if (q->tasks.empty()) continue;
+        if (i == id) {
+            task = std::move(q->tasks.back());
+            q->tasks.pop_back();
+        }
+        else {
+            task = std::move(q->tasks.front());
+            q->tasks.pop_front();
+        }
+        pending--;
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::RunPending()
+{
+    std::function<void()> task;
+    if (!Take((currentPool == this) ? currentWorker : -1, task)) return false;
+    task();
+    return true;
+}
+
+void ThreadPool::Worker(int id, int cpu)
+{
+#if defined(NOTWIN) && defined(CPU_SET)
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+#else
+    (void)cpu;
+#endif
+    currentPool = this;
+    currentWorker = id;
+
+    for (;;)
+    {
+        std::function<void()> task;
+        if (Take(id, task)) {
+            task();
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wake.wait(guard, [this] { return stop || pending > 0; });
+        if (stop) return;
+    }
+}
+
+/*
+    The chunks are handed out by a counter, to the caller and to the helpers
+    as they start. The caller only waits for chunks already running, so
+    nothing waits for a task still in a queue.
+*/
+struct ParallelRange {
+    s64 begin;
+    s64 end;
+    s64 chunks;
+    const std::function<void(s64, s64)>* body;
+    std::atomic<s64> next;
+    std::atomic<s64> done;
+    std::mutex lock;
+    std::condition_variable finished;
+
+    bool RunChunk()
+    {
+        s64 c = next++;
+        if (c >= chunks) return false;
+        s64 length = end - begin;
+        (*body)(begin + c * length / chunks, begin + (c + 1) * length / chunks);
+        if (++done == chunks) {
+            std::lock_guard<std::mutex> guard(lock);
+            finished.notify_all();
+        }
+        return true;
+    }
+};
+
+void ThreadPool::ParallelFor(s64 begin, s64 end, s64 chunks, const std::function<void(s64, s64)>& body)
+{
+    if (end <= begin) return;
+    if (chunks <= 0) chunks = Workers() + 1;
+    if (chunks > end - begin) chunks = end - begin;
+    if (chunks == 1 || threads.empty()) {
+        body(begin, end);
+        return;
+    }
+
+    std::shared_ptr<ParallelRange> range(new ParallelRange());
+    range->begin = begin;
+    range->end = end;
+    range->chunks = chunks;
+    range->body = &body;
+    range->next = 0;
+    range->done = 0;
+
+    s64 helpers = (chunks - 1 < Workers()) ? chunks - 1 : Workers();
+    for (s64 h = 0; h < helpers; h++)
+        Submit([range] { while (range->RunChunk()); });
+
+    while (range->RunChunk());
+
+    std::unique_lock<std::mutex> guard(range->lock);
+    range->finished.wait(guard, [&range] { return range->done == range->chunks; });
+}
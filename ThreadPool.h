@@ -0,0 +1,82 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+	A work-stealing thread pool, meant to be shared by all the plans of a
+	process so that concurrent transforms do not each start their own threads.
+
+	Every worker has its own queue. A worker takes its newest task first
+	and, when its queue is empty, the oldest task of the queue of callers
+	outside the pool, then the oldest task of another worker. Tasks
+	submitted from a worker go to that worker's queue, the others go to the
+	shared queue.
+
+	ParallelFor splits a range in chunks. The calling thread takes chunks
+	itself, the pool only adds helpers, so it also works from inside a task
+	and with no workers at all. Worker i can be pinned to cpus[i % size]
+	(Linux only).
+*/
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include "PrimeFactorDFT.h"
+
+class ThreadPool
+{
+public:
+
+	/*
+	*  workers threads, 0 is one per core less the calling thread.
+	*  With cpus worker i runs on cpus[i % cpus.size()].
+	*/
+	ThreadPool(int workers = 0, const std::vector<int>& cpus = std::vector<int>());
+	~ThreadPool();
+
+	/* the pool of the library, made on first use */
+	static ThreadPool* Default();
+
+	int Workers() { return (int)threads.size(); };
+
+	/*
+	*  Queues task and returns. Without workers it runs here.
+	*/
+	void Submit(std::function<void()> task);
+
+	/*
+	*  body(first, last) on at most chunks pieces of [begin, end), 0 is one
+	*  per worker and one for the caller. Returns when all are done.
+	*/
+	void ParallelFor(s64 begin, s64 end, s64 chunks, const std::function<void(s64, s64)>& body);
+
+	/*
+	*  Runs one queued task on the calling thread, false if there was none.
+	*/
+	bool RunPending();
+
+private:
+	struct Queue {
+		std::mutex lock;
+		std::deque< std::function<void()> > tasks;
+	};
+
+	void Worker(int id, int cpu);
+	bool Take(int id, std::function<void()>& task);
+
+	std::vector<std::thread> threads;
+	/* one per worker, the last one for callers outside the pool */
+	std::vector<Queue*> queues;
+	std::mutex sleepLock;
+	std::condition_variable wake;
+	std::atomic<s64> pending;
+	bool stop;
+};
@@ -0,0 +1,86 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+*/
+
+#include "TransformPipeline.h"
+
+void PipelineStep::await_suspend(std::coroutine_handle<> handle)
+{
+    std::function<void()> w = std::move(work);
+    pool->Submit([w, handle] {
+        w();
+        handle.resume();
+    });
+}
+
+static ThreadPool* PoolOf(PrimeFactorDFT& pf)
+{
+    return pf.Pool() ? pf.Pool() : ThreadPool::Default();
+}
+
+PipelineStep ForwardFFTStep(PrimeFactorDFT& pf, Data* real, Data *imag)
+{
+    PrimeFactorDFT* plan = &pf;
+    return PipelineStep(PoolOf(pf), [plan, real, imag] { plan->forwardFFT(real, imag); });
+}
+
+PipelineStep InverseFFTStep(PrimeFactorDFT& pf, Data* real, Data *imag)
+{
+    PrimeFactorDFT* plan = &pf;
+    return PipelineStep(PoolOf(pf), [plan, real, imag] { plan->InverseFFT(real, imag); });
+}
+
+PipelineStep ScaledInverseFFTStep(PrimeFactorDFT& pf, Data* real, Data *imag)
+{
+    PrimeFactorDFT* plan = &pf;
+    return PipelineStep(PoolOf(pf), [plan, real, imag] { plan->ScaledInverseFFT(real, imag); });
+}
+
+PipelineStep ComputeStep(std::function<void()> work, ThreadPool* pool)
+{
+    return PipelineStep(pool, std::move(work));
+}
+
+/*
+    The frame is gone once the pipeline is told, so it is destroyed first.
+*/
+void PipelineTask::FinalAwaiter::await_suspend(Handle handle) noexcept
+{
+    Pipeline* pipeline = handle.promise().pipeline;
+    handle.destroy();
+    if (pipeline) pipeline->Finished();
+}
+
+void Pipeline::Start(PipelineTask task)
+{
+    PipelineTask::Handle handle = task.handle;
+    task.handle = 0;
+    if (!handle) return;
+
+    handle.promise().pipeline = this;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running++;
+    }
+    pool->Submit([handle] { handle.resume(); });
+}
+
+void Pipeline::Finished()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    if (--running == 0) ended.notify_all();
+}
+
+void Pipeline::Wait()
+{
+    std::unique_lock<std::mutex> guard(lock);
+    ended.wait(guard, [this] { return running == 0; });
+}
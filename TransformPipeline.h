@@ -0,0 +1,245 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+	Coroutine pipelines of transforms, C++20.
+
+	Every stage of a pipeline is a coroutine returning PipelineTask that
+	takes items from one Channel and puts them in the next. A step awaits
+	the work it does: co_await ForwardFFTStep(pf, real, imag) runs the
+	transform as a task on the pool, and the coroutine continues on the
+	worker that did it. A Channel holds at most capacity items; a stage
+	pushing to a full channel, or popping from an empty one, is suspended
+	until there is room or an item, and no thread waits. So the items in
+	different stages run on different cores, and only the pool has threads.
+
+		Channel<Item*> loaded(4), multiplied(4);
+		PipelineTask Forward(Channel<Item*>& in, Channel<Item*>& out)
+		{
+			while (std::optional<Item*> item = co_await in.Pop()) {
+				co_await ForwardFFTStep(pf, (*item)->real, (*item)->imag);
+				co_await ComputeStep([=] { Multiply(*item); });
+				co_await out.Push(*item);
+			}
+			out.Close();
+		}
+		Pipeline pipeline;
+		pipeline.Start(Forward(loaded, multiplied));
+
+	Only this file and the code using it need -std=c++20.
+*/
+#if !(__cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L))
+#error "TransformPipeline.h needs C++20"
+#endif
+
+#include <coroutine>
+#include <deque>
+#include <optional>
+#include "ThreadPool.h"
+
+/*
+*  Runs work as a task on the pool, the awaiting coroutine continues there.
+*/
+class PipelineStep
+{
+public:
+	PipelineStep(ThreadPool* _pool, std::function<void()> _work) { pool = _pool; work = std::move(_work); };
+
+	bool await_ready() { return false; };
+	void await_suspend(std::coroutine_handle<> handle);
+	void await_resume() {};
+
+private:
+	ThreadPool* pool;
+	std::function<void()> work;
+};
+
+/* the transforms of pf, on its pool or ThreadPool::Default() */
+PipelineStep ForwardFFTStep(PrimeFactorDFT& pf, Data* real, Data *imag);
+PipelineStep InverseFFTStep(PrimeFactorDFT& pf, Data* real, Data *imag);
+PipelineStep ScaledInverseFFTStep(PrimeFactorDFT& pf, Data* real, Data *imag);
+/* any other work, a multiply or a post-process */
+PipelineStep ComputeStep(std::function<void()> work, ThreadPool* pool = ThreadPool::Default());
+
+class Pipeline;
+
+/*
+*  A stage of a pipeline, it starts when given to Pipeline::Start.
+*/
+class PipelineTask
+{
+public:
+	struct promise_type;
+	typedef std::coroutine_handle<promise_type> Handle;
+
+	struct FinalAwaiter {
+		bool await_ready() noexcept { return false; };
+		void await_suspend(Handle handle) noexcept;
+		void await_resume() noexcept {};
+	};
+
+	struct promise_type {
+		Pipeline* pipeline = 0;
+
+		PipelineTask get_return_object() { return PipelineTask(Handle::from_promise(*this)); };
+		std::suspend_always initial_suspend() noexcept { return {}; };
+		FinalAwaiter final_suspend() noexcept { return {}; };
+		void return_void() {};
+		void unhandled_exception() { std::terminate(); };
+	};
+
+	PipelineTask(PipelineTask&& other) { handle = other.handle; other.handle = 0; };
+	~PipelineTask() { if (handle) handle.destroy(); };
+
+	PipelineTask(const PipelineTask&) = delete;
+	PipelineTask& operator=(const PipelineTask&) = delete;
+
+private:
+	friend class Pipeline;
+	explicit PipelineTask(Handle _handle) { handle = _handle; };
+	Handle handle;
+};
+
+/*
+*  The stages of a pipeline, run on pool. Wait returns when all have ended.
+*/
+class Pipeline
+{
+public:
+	Pipeline(ThreadPool* _pool = ThreadPool::Default()) { pool = _pool; running = 0; };
+	~Pipeline() { Wait(); };
+
+	void Start(PipelineTask task);
+	void Wait();
+
+private:
+	friend class PipelineTask;
+	void Finished();
+
+	ThreadPool* pool;
+	std::mutex lock;
+	std::condition_variable ended;
+	s64 running;
+};
+
+/*
+*  A bounded queue between stages. Push and Pop are awaited, a suspended
+*  stage is resumed on the pool. Pop gives std::nullopt once the channel
+*  is closed and empty.
+*/
+template <class T>
+class Channel
+{
+public:
+	Channel(std::size_t _capacity, ThreadPool* _pool = ThreadPool::Default())
+	{
+		capacity = (_capacity > 0) ? _capacity : 1;
+		pool = _pool;
+		closed = false;
+	};
+
+	struct PushAwaiter {
+		Channel* channel;
+		T item;
+		bool await_ready() { return false; };
+		bool await_suspend(std::coroutine_handle<> handle) { return channel->SuspendPush(handle, this); };
+		void await_resume() {};
+	};
+
+	struct PopAwaiter {
+		Channel* channel;
+		std::optional<T> item;
+		bool await_ready() { return false; };
+		bool await_suspend(std::coroutine_handle<> handle) { return channel->SuspendPop(handle, this); };
+		std::optional<T> await_resume() { return std::move(item); };
+	};
+
+	PushAwaiter Push(T item) { return PushAwaiter{ this, std::move(item) }; };
+	PopAwaiter Pop() { return PopAwaiter{ this, std::nullopt }; };
+
+	/* no more pushes, the waiting pops get std::nullopt */
+	void Close()
+	{
+		std::vector< std::coroutine_handle<> > wake;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			closed = true;
+			if (items.empty())
+				while (!poppers.empty()) {
+					wake.push_back(poppers.front().first);
+					poppers.pop_front();
+				}
+		}
+		Resume(wake);
+	};
+
+private:
+	/* false: done without suspending */
+	bool SuspendPush(std::coroutine_handle<> handle, PushAwaiter* push)
+	{
+		std::vector< std::coroutine_handle<> > wake;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (!poppers.empty()) {
+				/* straight to a waiting stage */
+				poppers.front().second->item = std::move(push->item);
+				wake.push_back(poppers.front().first);
+				poppers.pop_front();
+			}
+			else if (items.size() < capacity)
+				items.push_back(std::move(push->item));
+			else {
+				pushers.push_back(std::make_pair(handle, push));
+				return true;
+			}
+		}
+		Resume(wake);
+		return false;
+	};
+
+	bool SuspendPop(std::coroutine_handle<> handle, PopAwaiter* pop)
+	{
+		std::vector< std::coroutine_handle<> > wake;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (!items.empty()) {
+				pop->item = std::move(items.front());
+				items.pop_front();
+				if (!pushers.empty()) {
+					items.push_back(std::move(pushers.front().second->item));
+					wake.push_back(pushers.front().first);
+					pushers.pop_front();
+				}
+			}
+			else if (!closed) {
+				poppers.push_back(std::make_pair(handle, pop));
+				return true;
+			}
+		}
+		Resume(wake);
+		return false;
+	};
+
+	void Resume(std::vector< std::coroutine_handle<> >& wake)
+	{
+		for (std::size_t i = 0; i < wake.size(); i++) {
+			std::coroutine_handle<> h = wake[i];
+			pool->Submit([h] { h.resume(); });
+		}
+	};
+
+	std::size_t capacity;
+	ThreadPool* pool;
+	bool closed;
+	std::mutex lock;
+	std::deque<T> items;
+	std::deque< std::pair<std::coroutine_handle<>, PushAwaiter*> > pushers;
+	std::deque< std::pair<std::coroutine_handle<>, PopAwaiter*> > poppers;
+};
@@ -0,0 +1,239 @@
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+*/
+
+#include <cmath>
+#include "TrigTransform.h"
+
+#define PI 3.141592653589793238462643383279503L
+
+s64 TrigTransform::SetType(int _type, factorSeq& factors)
+{
+    length = 0;
+    pf.SetFactors(factors);
+    s64 L = pf.Status();
+    if (L <= 0) return L;
+
+    type = _type;
+    switch (type) {
+    case DCT1: if (L % 2) return -1; length = L / 2 + 1; break;
+    case DST1: if (L % 2 || L < 4) return -1; length = L / 2 - 1; break;
+    case DCT2: case DCT3: case DCT4:
+    case DST2: case DST3: case DST4: length = L; break;
+    default: return -1;
+    }
+
+    real.resize(L);
+    imag.resize(L);
+
+    cosine.resize(length);
+    sine.resize(length);
+    halfCosine.resize(length);
+    halfSine.resize(length);
+    scratch.resize(type == DCT4 || type == DST4 ? length : 0);
+    for (s64 k = 0; k < length; k++) {
+        cosine[k] = (Data)std::cos(PI * k / (2 * length));
+        sine[k] = (Data)-std::sin(PI * k / (2 * length));
+        halfCosine[k] = (Data)std::cos(PI * (2 * k + 1) / (4 * length));
+        halfSine[k] = (Data)std::sin(PI * (2 * k + 1) / (4 * length));
+    }
+    return length;
+}
+
+void TrigTransform::Alternate(Data* x, s64 n)
+{
+    for (s64 i = 1; i < n; i += 2) x[i] = -x[i];
+}
+
+void TrigTransform::Reverse(Data* x, s64 n)
+{
+    for (s64 i = 0, j = n - 1; i < j; i++, j--) {
+        Data t = x[i];
+        x[i] = x[j];
+        x[j] = t;
+    }
+}
+
+/*
+    DCT-II, v[n] = x[2n], v[N - 1 - n] = x[2n + 1], V the transform of v, then
+        Y[k] = 2 Re(e^(-i pi k / 2N) V[k])
+    With x in the real and y in the imaginary part, Z = V + iW and
+        V[k] = (Z[k] + conj(Z[-k])) / 2,   W[k] = (Z[k] - conj(Z[-k])) / 2i
+*/
+void TrigTransform::Makhoul(Data* x, Data* y)
+{
+    s64 N = length;
+    for (s64 n = 0; 2 * n < N; n++) {
+        real[n] = x[2 * n];
+        imag[n] = y ? y[2 * n] : 0;
+    }
+    for (s64 n = 0; 2 * n + 1 < N; n++) {
+        real[N - 1 - n] = x[2 * n + 1];
+        imag[N - 1 - n] = y ? y[2 * n + 1] : 0;
+    }
+
+    pf.forwardFFT(real.data(), imag.data());
+
+    for (s64 k = 0; k < N; k++) {
+        s64 j = (N - k) % N;
+        Data vr = (real[k] + real[j]) / 2;
+        Data vi = (imag[k] - imag[j]) / 2;
+        x[k] = 2 * (cosine[k] * vr - sine[k] * vi);
+        if (y) {
+            Data wr = (imag[k] + imag[j]) / 2;
+            Data wi = (real[j] - real[k]) / 2;
+            y[k] = 2 * (cosine[k] * wr - sine[k] * wi);
+        }
+    }
+}
+
+/*
+    DCT-III is the transpose of DCT-II with x[0] halved,
+        u = 2 Re(F c),  c[k] = e^(-i pi k / 2N) x[k]
+    and Y[2n] = u[n], Y[2n + 1] = u[N - 1 - n]. With h[k] = (c[k] + conj(c[-k])) / 2,
+    Re(F c) = F h, and F h is real since h is hermitian, so x goes through the
+    real and y through the imaginary part of one transform.
+*/
+void TrigTransform::InverseMakhoul(Data* x, Data* y)
+{
+    s64 N = length;
+    real[0] = x[0] / 2;
+    imag[0] = y ? y[0] / 2 : 0;
+    for (s64 k = 1; k < N; k++) {
+        s64 j = N - k;
+        /* h[k] = (c[k] + conj(c[j])) / 2 for x, plus i times the same for y */
+        Data hr = (cosine[k] * x[k] + cosine[j] * x[j]) / 2;
+        Data hi = (sine[k] * x[k] - sine[j] * x[j]) / 2;
+        Data gr = 0, gi = 0;
+        if (y) {
+            gr = (cosine[k] * y[k] + cosine[j] * y[j]) / 2;
+            gi = (sine[k] * y[k] - sine[j] * y[j]) / 2;
+        }
+        real[k] = hr - gi;
+        imag[k] = hi + gr;
+    }
+
+    pf.forwardFFT(real.data(), imag.data());
+
+    for (s64 n = 0; 2 * n < N; n++) {
+        x[2 * n] = 2 * real[n];
+        if (y) y[2 * n] = 2 * imag[n];
+    }
+    for (s64 n = 0; 2 * n + 1 < N; n++) {
+        x[2 * n + 1] = 2 * real[N - 1 - n];
+        if (y) y[2 * n + 1] = 2 * imag[N - 1 - n];
+    }
+}
+
+/*
+    With A = pi (n + 1/2) / N,  cos(A (k + 1/2)) = cos(A k) cos(A/2) - sin(A k) sin(A/2),
+    so Y[k] = C[k] - S[k - 1], S[-1] = 0, with C the DCT-II of cos(A/2) x and
+    S the DST-II of sin(A/2) x. The DST-II is a DCT-II as in Evaluate, and
+    the two go through one transform. No output depends on another.
+*/
+void TrigTransform::TypeFour(Data* x, Data* y)
+{
+    s64 N = length;
+    for (int sequence = 0; sequence < (y ? 2 : 1); sequence++)
+    {
+        Data* z = sequence ? y : x;
+        Data* s = scratch.data();
+        for (s64 n = 0; n < N; n++) {
+            s[n] = (n % 2) ? -halfSine[n] * z[n] : halfSine[n] * z[n];
+            z[n] *= halfCosine[n];
+        }
+
+        Makhoul(z, s);
+
+        /* S[k - 1] is s[N - k] */
+        for (s64 k = 1; k < N; k++) z[k] -= s[N - k];
+    }
+}
+
+/*
+    DCT-I, the transform of the even extension e[n] = e[2(N - 1) - n] = x[n] is real.
+*/
+void TrigTransform::CosineOne(Data* x, Data* y)
+{
+    s64 N = length;
+    s64 L = 2 * (N - 1);
+    for (s64 n = 0; n < N; n++) {
+        real[n] = x[n];
+        imag[n] = y ? y[n] : 0;
+    }
+    for (s64 n = 1; n < N - 1; n++) {
+        real[L - n] = real[n];
+        imag[L - n] = imag[n];
+    }
+
+    pf.forwardFFT(real.data(), imag.data());
+
+    for (s64 k = 0; k < N; k++) {
+        x[k] = real[k];
+        if (y) y[k] = imag[k];
+    }
+}
+
+/*
+    DST-I, the odd extension o[n + 1] = -o[2(N + 1) - n - 1] = x[n], o[0] = o[N + 1] = 0
+    has the transform O[k + 1] = -i Y[k].
+*/
+void TrigTransform::SineOne(Data* x, Data* y)
+{
+    s64 N = length;
+    s64 L = 2 * (N + 1);
+    real[0] = imag[0] = 0;
+    real[N + 1] = imag[N + 1] = 0;
+    for (s64 n = 0; n < N; n++) {
+        real[n + 1] = x[n];
+        imag[n + 1] = y ? y[n] : 0;
+        real[L - n - 1] = -real[n + 1];
+        imag[L - n - 1] = -imag[n + 1];
+    }
+
+    pf.forwardFFT(real.data(), imag.data());
+
+    for (s64 k = 0; k < N; k++) {
+        x[k] = -imag[k + 1];
+        if (y) y[k] = real[k + 1];
+    }
+}
+
+/*
+    DST-II(x)[k] = DCT-II(x')[N - 1 - k],  DST-IV likewise, x'[n] = (-1)^n x[n]
+    DST-III(x)[k] = (-1)^k DCT-III(x reversed)[k]
+*/
+void TrigTransform::Evaluate(Data* x, Data* y)
+{
+    if (length <= 0) return;
+
+    switch (type) {
+    case DCT1: CosineOne(x, y); break;
+    case DST1: SineOne(x, y); break;
+    case DCT2: Makhoul(x, y); break;
+    case DCT3: InverseMakhoul(x, y); break;
+    case DCT4: TypeFour(x, y); break;
+    case DST2:
+    case DST4:
+        Alternate(x, length);
+        if (y) Alternate(y, length);
+        if (type == DST2) Makhoul(x, y); else TypeFour(x, y);
+        Reverse(x, length);
+        if (y) Reverse(y, length);
+        break;
+    case DST3:
+        Reverse(x, length);
+        if (y) Reverse(y, length);
+        InverseMakhoul(x, y);
+        Alternate(x, length);
+        if (y) Alternate(y, length);
+        break;
+    }
+}
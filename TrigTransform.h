@@ -0,0 +1,76 @@
+#pragma once
+/*
+Copyright  © 2024 Claus Vind-Andreasen
+
+This program is free software; you can redistribute it and /or modify it under the terms of the GNU General Public License as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+This program is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with this program; if not, write to the Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111 - 1307 USA
+This General Public License does not permit incorporating your program into proprietary programs.If your program is a subroutine library, you may consider it more useful to permit linking proprietary applications with the library.
+If this is what you want to do, use the GNU Library General Public License instead of this License.
+
+
+	Discrete cosine and sine transforms of types I - IV of real data, with
+	the unnormalized definitions of FFTW (REDFT00 ... RODFT11), e.g.
+		DCT-II   Y[k] = 2 sum x[n] cos(pi (n + 1/2) k / N)
+		DCT-III  Y[k] = x[0] + 2 sum(n > 0) x[n] cos(pi n (k + 1/2) / N)
+	DCT-III is the inverse of DCT-II up to the factor 2N, DCT-IV and DST-IV
+	are their own inverses up to 2N.
+
+	Types II and III are permutations of a real transform of the same length
+	(Makhoul), type IV is a type II DCT and DST of the input weighted by
+	cos and sin of pi (n + 1/2) / 2N, both in one real transform, and the
+	DSTs are the DCTs with the signs of every other input flipped and the
+	output reversed. Type I is the real transform of the symmetric extension,
+	2(N - 1) points for DCT-I and 2(N + 1) for DST-I, so that length has to
+	be a supported length.
+
+	The data is real, so two sequences may go through one transform, one in
+	the real and one in the imaginary part. Type IV fills both parts itself
+	and takes a transform per sequence.
+*/
+#include "PrimeFactorDFT.h"
+
+class TrigTransform
+{
+public:
+	enum { DCT1, DCT2, DCT3, DCT4, DST1, DST2, DST3, DST4 };
+
+	TrigTransform() { type = DCT2; length = 0; };
+	~TrigTransform() {};
+
+	/*
+	*  The factors are those of the real transform used, for types II - IV
+	*  the length of the DCT/DST, for type I the length of the extension.
+	*  Returns the length N of the DCT/DST, or < 0 if there is none.
+	*/
+	s64 SetType(int _type, factorSeq& factors);
+
+	s64 Length() { return length; };
+
+	/*
+	*  Transforms x in place, and y as well if given.
+	*/
+	void Evaluate(Data* x, Data* y = 0);
+
+private:
+	void Makhoul(Data* x, Data* y);
+	void InverseMakhoul(Data* x, Data* y);
+	void TypeFour(Data* x, Data* y);
+	void CosineOne(Data* x, Data* y);
+	void SineOne(Data* x, Data* y);
+	static void Alternate(Data* x, s64 n);
+	static void Reverse(Data* x, s64 n);
+
+	PrimeFactorDFT pf;
+	int type;
+	s64 length;
+	/* e^(-i pi k / 2N) */
+	std::vector<Data> cosine;
+	std::vector<Data> sine;
+	/* cos and sin of pi (2n + 1) / 4N, and the DST half, type IV */
+	std::vector<Data> halfCosine;
+	std::vector<Data> halfSine;
+	std::vector<Data> scratch;
+	std::vector<Data> real;
+	std::vector<Data> imag;
+};